@@ -0,0 +1,145 @@
+// Connection pool contention benchmark
+//
+// Measures acquire/release throughput of database_pool against a reference
+// pool built the way database_pool used to be (one mutex, a std::queue of
+// connections, one condition variable and two std::function closures per
+// handle). No queries are run, so the numbers isolate pool overhead.
+//
+// Usage: pool_contention_benchmark [connection_string] [max_connections]
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "../src/fenrir.hpp"
+
+using namespace fenrir;
+
+namespace {
+
+    constexpr const char* DEFAULT_CONNECTION_STRING = "host=localhost dbname=testdb user=testuser password=testpass";
+    constexpr int OPERATIONS_PER_THREAD = 20000;
+
+    // Previous database_pool design, reduced to acquire/release
+    class mutex_pool {
+    public:
+        class handle {
+        public:
+            handle(std::unique_ptr<database_connection> conn,
+                   std::function<void(std::unique_ptr<database_connection>)> returner,
+                   std::function<std::unique_ptr<database_connection>()> reconnector)
+                : conn_(std::move(conn)), returner_(std::move(returner)), reconnector_(std::move(reconnector)) {}
+
+            ~handle() {
+                if (conn_ && returner_) returner_(std::move(conn_));
+            }
+
+            handle(const handle&) = delete;
+            handle& operator=(const handle&) = delete;
+
+            database_connection* operator->() { return conn_.get(); }
+
+        private:
+            std::unique_ptr<database_connection> conn_;
+            std::function<void(std::unique_ptr<database_connection>)> returner_;
+            std::function<std::unique_ptr<database_connection>()> reconnector_;
+        };
+
+        mutex_pool(const std::string& connection_string, size_t size) : connection_string_(connection_string) {
+            for (size_t i = 0; i < size; ++i) {
+                available_.push(std::make_unique<database_connection>(connection_string_));
+            }
+        }
+
+        handle acquire() {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_.wait(lock, [this] { return !available_.empty(); });
+            auto conn = std::move(available_.front());
+            available_.pop();
+            return handle(
+                std::move(conn),
+                [this](std::unique_ptr<database_connection> c) { release(std::move(c)); },
+                [this] { return std::make_unique<database_connection>(connection_string_); });
+        }
+
+    private:
+        void release(std::unique_ptr<database_connection> conn) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            available_.push(std::move(conn));
+            cv_.notify_one();
+        }
+
+        std::string connection_string_;
+        std::mutex mutex_;
+        std::condition_variable cv_;
+        std::queue<std::unique_ptr<database_connection>> available_;
+    };
+
+    // Acquire/release operations per second across num_threads threads
+    template<typename Pool>
+    double run(Pool& pool, int num_threads) {
+        std::atomic<bool> start{false};
+        std::vector<std::thread> threads;
+        threads.reserve(num_threads);
+
+        for (int t = 0; t < num_threads; ++t) {
+            threads.emplace_back([&] {
+                while (!start.load(std::memory_order_acquire)) {
+                    std::this_thread::yield();
+                }
+                for (int i = 0; i < OPERATIONS_PER_THREAD; ++i) {
+                    auto conn = pool.acquire();
+                    (void)conn->is_connected();
+                }
+            });
+        }
+
+        auto begin = std::chrono::steady_clock::now();
+        start.store(true, std::memory_order_release);
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+
+        return static_cast<double>(num_threads) * OPERATIONS_PER_THREAD / elapsed.count();
+    }
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::string connection_string = argc > 1 ? argv[1] : DEFAULT_CONNECTION_STRING;
+    size_t pool_size = argc > 2 ? std::stoul(argv[2]) : 16;
+
+    try {
+        // Assigned field by field: pool_config has too many members to list
+        database_pool::pool_config config;
+        config.connection_string = connection_string;
+        config.min_connections = pool_size;
+        config.max_connections = pool_size;
+        config.validate_on_acquire = false;
+        database_pool pool(config);
+        mutex_pool baseline(connection_string, pool_size);
+
+        std::cout << std::format("pool size {}, {} acquire/release per thread\n\n",
+                                 pool_size, OPERATIONS_PER_THREAD);
+        std::cout << std::format("{:>8} {:>16} {:>16} {:>8}\n", "threads", "mutex (ops/s)", "lock-free (ops/s)", "speedup");
+
+        for (int num_threads : {1, 4, 16, 32, 64}) {
+            double before = run(baseline, num_threads);
+            double after = run(pool, num_threads);
+            std::cout << std::format("{:>8} {:>16.0f} {:>16.0f} {:>7.2f}x\n",
+                                     num_threads, before, after, after / before);
+        }
+        return 0;
+    } catch (const database_error& e) {
+        std::cerr << "Error: " << e.what() << "\n";
+        return 1;
+    }
+}
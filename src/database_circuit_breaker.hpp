@@ -0,0 +1,145 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <mutex>
+
+namespace fenrir {
+
+    enum class circuit_state {
+        closed,     // Normal operation
+        open,       // Failing fast
+        half_open   // Letting a few probes through to test recovery
+    };
+
+    // Settings of database_pool's circuit breaker
+    struct circuit_breaker_config {
+        bool enabled = false;
+        size_t failure_threshold = 5;                       // Failures within one window needed to trip...
+        double failure_rate = 0.5;                          // ...if they are also at least this share of outcomes
+        std::chrono::milliseconds window{10000};            // Outcomes are counted per window of this length
+        std::chrono::milliseconds open_duration{5000};      // Fail fast this long before probing
+        size_t half_open_probes = 2;                        // Acquires let through while half-open; as many
+                                                            // successes close the breaker
+    };
+
+    namespace detail {
+
+        // Closed / open / half-open circuit breaker over connection outcomes
+        // Closed: outcomes are counted per window, and the breaker opens when
+        // enough of them fail. Open: allow() refuses until open_duration has
+        // passed. Half-open: half_open_probes callers are let through (again
+        // after another open_duration if they report nothing); as many
+        // successes close the breaker, one failure opens it again. While
+        // closed, allow() is a single atomic load.
+        class circuit_breaker {
+        public:
+            using clock = std::chrono::steady_clock;
+
+            explicit circuit_breaker(const circuit_breaker_config& config) : config_(config) {}
+
+            [[nodiscard]] bool allow() noexcept {
+                if (state_.load(std::memory_order_acquire) == circuit_state::closed) return true;
+
+                auto now = clock::now();
+                std::lock_guard<std::mutex> lock(mutex_);
+                switch (state_.load(std::memory_order_relaxed)) {
+                    case circuit_state::closed:
+                        return true;
+                    case circuit_state::open:
+                        if (now < reopen_at_) return false;
+                        state_.store(circuit_state::half_open, std::memory_order_release);
+                        start_probing(now);
+                        [[fallthrough]];
+                    case circuit_state::half_open:
+                        if (probes_admitted_ >= config_.half_open_probes) {
+                            // Probes that timed out waiting report no outcome
+                            if (now < reopen_at_) return false;
+                            start_probing(now);
+                        }
+                        ++probes_admitted_;
+                        return true;
+                }
+                return false;
+            }
+
+            void record_success(clock::time_point now) noexcept {
+                if (state_.load(std::memory_order_acquire) == circuit_state::closed) {
+                    roll_window(now);
+                    successes_.fetch_add(1, std::memory_order_relaxed);
+                    return;
+                }
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (state_.load(std::memory_order_relaxed) == circuit_state::half_open &&
+                    ++probe_successes_ >= config_.half_open_probes) {
+                    failures_.store(0, std::memory_order_relaxed);
+                    successes_.store(0, std::memory_order_relaxed);
+                    window_start_.store(now.time_since_epoch().count(), std::memory_order_relaxed);
+                    state_.store(circuit_state::closed, std::memory_order_release);
+                }
+            }
+
+            // Returns true if this failure opened the breaker
+            bool record_failure(clock::time_point now) noexcept {
+                auto state = state_.load(std::memory_order_acquire);
+                if (state == circuit_state::closed) {
+                    roll_window(now);
+                    auto failures = failures_.fetch_add(1, std::memory_order_relaxed) + 1;
+                    auto total = failures + successes_.load(std::memory_order_relaxed);
+                    if (failures < config_.failure_threshold ||
+                        static_cast<double>(failures) < config_.failure_rate * static_cast<double>(total)) {
+                        return false;
+                    }
+                }
+                if (state == circuit_state::open) return false;  // Stragglers from before the trip
+
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (state_.load(std::memory_order_relaxed) == circuit_state::open) return false;
+                reopen_at_ = now + config_.open_duration;
+                state_.store(circuit_state::open, std::memory_order_release);
+                return true;
+            }
+
+            [[nodiscard]] circuit_state state() const noexcept {
+                return state_.load(std::memory_order_acquire);
+            }
+
+        private:
+            // With mutex_ held
+            void start_probing(clock::time_point now) noexcept {
+                probes_admitted_ = 0;
+                probe_successes_ = 0;
+                reopen_at_ = now + config_.open_duration;
+            }
+
+            // Start a new counting window once the current one is over
+            void roll_window(clock::time_point now) noexcept {
+                auto start = window_start_.load(std::memory_order_relaxed);
+                auto now_ticks = now.time_since_epoch().count();
+                auto window = std::chrono::duration_cast<clock::duration>(config_.window).count();
+                if (now_ticks - start >= window &&
+                    window_start_.compare_exchange_strong(start, now_ticks, std::memory_order_relaxed)) {
+                    failures_.store(0, std::memory_order_relaxed);
+                    successes_.store(0, std::memory_order_relaxed);
+                }
+            }
+
+            circuit_breaker_config config_;
+            std::atomic<circuit_state> state_{circuit_state::closed};
+
+            // Outcomes in the current window (closed state)
+            std::atomic<clock::rep> window_start_{clock::now().time_since_epoch().count()};
+            std::atomic<size_t> failures_{0};
+            std::atomic<size_t> successes_{0};
+
+            // Open and half-open state, guarded by mutex_
+            std::mutex mutex_;
+            clock::time_point reopen_at_{};  // End of the open state, or of the current probe round
+            size_t probes_admitted_ = 0;
+            size_t probe_successes_ = 0;
+        };
+
+    } // namespace detail
+
+} // namespace fenrir
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+namespace fenrir {
+
+    // Settings of database_pool's adaptive concurrency limit
+    struct concurrency_limit_config {
+        bool enabled = false;
+        size_t initial_limit = 0;   // 0 = a quarter of max_connections
+        size_t min_limit = 1;
+        double tolerance = 1.5;     // Rise of the recent RTT over the no-load RTT accepted before shrinking
+        double smoothing = 0.2;     // Weight of each new limit estimate
+        size_t short_window = 10;   // Samples averaged into the current RTT
+        size_t long_window = 20000; // Samples over which the no-load RTT may at most double
+        bool reject = false;        // Fail acquires over the limit at once instead of queuing them
+    };
+
+    namespace detail {
+
+        // Gradient concurrency limiter, after Netflix's Gradient2 and TCP Vegas
+        // Compares the recent average round trip with the no-load round trip,
+        // taken as the fastest recent average. While they agree the limit grows
+        // by about its square root per update; when recent round trips get
+        // slower (the server is queueing work) it shrinks in proportion, by at
+        // most half per update. Samples taken while less than half the limit is
+        // in use do not move it: an idle pool says nothing about how much load
+        // the server can take.
+        class gradient_limiter {
+        public:
+            gradient_limiter(const concurrency_limit_config& config, size_t max_limit)
+                : config_(config),
+                  max_limit_(std::max<size_t>(max_limit, 1)),
+                  estimate_(static_cast<double>(std::clamp<size_t>(
+                      config.initial_limit ? config.initial_limit : max_limit / 4,
+                      std::max<size_t>(config.min_limit, 1), max_limit_))),
+                  limit_(static_cast<size_t>(estimate_)) {}
+
+            // Count a caller in unless the limit is reached
+            bool try_acquire() noexcept {
+                size_t current = in_flight_.load(std::memory_order_relaxed);
+                do {
+                    if (current >= limit_.load(std::memory_order_relaxed)) return false;
+                } while (!in_flight_.compare_exchange_weak(current, current + 1, std::memory_order_relaxed));
+                return true;
+            }
+
+            // Count a caller out without a measurement (it never ran a query)
+            void release() noexcept {
+                in_flight_.fetch_sub(1, std::memory_order_relaxed);
+            }
+
+            // Count a caller out and feed its round trip into the limit
+            void release(std::chrono::steady_clock::duration rtt) noexcept {
+                size_t in_flight = in_flight_.fetch_sub(1, std::memory_order_relaxed);
+                sample(rtt, in_flight);
+            }
+
+            [[nodiscard]] size_t limit() const noexcept { return limit_.load(std::memory_order_relaxed); }
+            [[nodiscard]] size_t in_flight() const noexcept { return in_flight_.load(std::memory_order_relaxed); }
+            [[nodiscard]] bool at_limit() const noexcept { return in_flight() >= limit(); }
+
+        private:
+            void sample(std::chrono::steady_clock::duration rtt, size_t in_flight) noexcept {
+                // One update at a time; a sample that arrives meanwhile is dropped
+                if (updating_.test_and_set(std::memory_order_acquire)) return;
+
+                double us = std::max(std::chrono::duration<double, std::micro>(rtt).count(), 1.0);
+                short_rtt_ = samples_++ == 0 ? us : short_rtt_ + (us - short_rtt_) * weight(config_.short_window);
+
+                // Re-estimate once per short window, when the recent average is
+                // made of fresh samples
+                if (samples_ % std::max<size_t>(config_.short_window, 1) == 0) {
+                    // The no-load RTT creeps up, so a lasting change in the
+                    // workload is learnt over a few long_windows
+                    double creep = std::exp2(static_cast<double>(std::max<size_t>(config_.short_window, 1)) /
+                                             static_cast<double>(std::max<size_t>(config_.long_window, 1)));
+                    no_load_rtt_ = no_load_rtt_ == 0 ? short_rtt_ : std::min(short_rtt_, no_load_rtt_ * creep);
+
+                    if (static_cast<double>(in_flight) >= estimate_ / 2) {
+                        double gradient = std::clamp(config_.tolerance * no_load_rtt_ / short_rtt_, 0.5, 1.0);
+                        double target = gradient < 1.0 ? estimate_ * gradient : estimate_ + std::sqrt(estimate_);
+                        estimate_ = std::clamp(estimate_ * (1 - config_.smoothing) + target * config_.smoothing,
+                                               static_cast<double>(std::max<size_t>(config_.min_limit, 1)),
+                                               static_cast<double>(max_limit_));
+                        limit_.store(static_cast<size_t>(estimate_), std::memory_order_relaxed);
+                    }
+                }
+
+                updating_.clear(std::memory_order_release);
+            }
+
+            static double weight(size_t window) noexcept {
+                return 2.0 / (static_cast<double>(std::max<size_t>(window, 1)) + 1.0);
+            }
+
+            concurrency_limit_config config_;
+            size_t max_limit_;
+            std::atomic<size_t> in_flight_{0};
+            std::atomic_flag updating_;
+
+            // Guarded by updating_
+            double estimate_;
+            double short_rtt_ = 0;
+            double no_load_rtt_ = 0;
+            std::uint64_t samples_ = 0;
+
+            std::atomic<size_t> limit_;
+        };
+
+    } // namespace detail
+
+} // namespace fenrir
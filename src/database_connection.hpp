@@ -10,31 +10,26 @@
 #include <format>
 #include <source_location>
 #include <chrono>
+#include <cstdint>
 #include <iostream>
+#include <ranges>
+#include <span>
+#include <vector>
+#include <unordered_map>
 #include <boost/asio.hpp>
 #include <boost/asio/awaitable.hpp>
 #include <boost/asio/use_awaitable.hpp>
 #include <boost/asio/steady_timer.hpp>
 #include <coroutine>
+#include "database_error.hpp"
 
 namespace fenrir {
 
     namespace net = boost::asio;
 
-    // Forward declaration
+    // Forward declarations
     class query_result;
-
-    // Error type for database operations
-    struct database_error : public std::runtime_error {
-        std::string sql_state;
-        std::source_location location;
-        
-        database_error(std::string msg, std::string state = "", 
-                      std::source_location loc = std::source_location::current())
-            : std::runtime_error(msg), sql_state(std::move(state)), location(loc) {}
-        
-        std::string message() const { return what(); }
-    };
+    class database_pipeline;
 
     // Connection status enum
     enum class connection_status {
@@ -49,6 +44,76 @@ namespace fenrir {
         needed
     };
 
+    namespace detail {
+
+        template<typename T>
+        struct is_optional : std::false_type {};
+
+        template<typename T>
+        struct is_optional<std::optional<T>> : std::true_type {};
+
+        // Ranges other than strings are bound as PostgreSQL arrays
+        template<typename T>
+        concept array_param =
+            std::ranges::input_range<T> &&
+            !std::convertible_to<const T&, std::string_view>;
+
+        // Append one element of a PostgreSQL array literal
+        // Strings are always quoted, nested ranges become sub-arrays and
+        // empty optionals become NULL.
+        template<typename T>
+        void append_array_element(std::string& out, const T& value);
+
+        // Render a range as a PostgreSQL array literal, e.g. {1,2,NULL}
+        template<typename R>
+        [[nodiscard]] std::string array_literal(const R& values) {
+            std::string out = "{";
+            bool first = true;
+            for (const auto& value : values) {
+                if (!first) out += ',';
+                append_array_element(out, value);
+                first = false;
+            }
+            out += '}';
+            return out;
+        }
+
+        template<typename T>
+        void append_array_element(std::string& out, const T& value) {
+            if constexpr (is_optional<T>::value) {
+                if (!value.has_value()) {
+                    out += "NULL";
+                    return;
+                }
+                append_array_element(out, *value);
+            } else if constexpr (std::is_same_v<T, bool>) {
+                out += value ? "t" : "f";
+            } else if constexpr (std::is_arithmetic_v<T>) {
+                out += std::format("{}", value);
+            } else if constexpr (array_param<T>) {
+                out += array_literal(value);
+            } else {
+                std::string_view text;
+                std::string formatted;
+                if constexpr (std::is_convertible_v<const T&, std::string_view>) {
+                    text = value;
+                } else {
+                    formatted = std::format("{}", value);
+                    text = formatted;
+                }
+                out += '"';
+                for (char c : text) {
+                    if (c == '"' || c == '\\') {
+                        out += '\\';
+                    }
+                    out += c;
+                }
+                out += '"';
+            }
+        }
+
+    } // namespace detail
+
     // C++20 concept for connection string types
     template<typename T>
     concept ConnectionString = std::convertible_to<T, std::string_view>;
@@ -74,28 +139,43 @@ namespace fenrir {
         };
 
         explicit database_connection(const connection_params& params) {
-            auto conn_str = std::format(
+            connect(to_conninfo(params));
+        }
+
+        // libpq connection string for a set of named parameters
+        [[nodiscard]] static std::string to_conninfo(const connection_params& params) {
+            return std::format(
                 "host={} port={} dbname={} user={} password={} connect_timeout={} "
                 "application_name={} client_encoding={}",
                 params.host, params.port, params.database, params.user, params.password,
                 params.connect_timeout.count(), params.application_name, params.client_encoding
             );
-            connect(conn_str);
         }
 
+        // Connect without blocking the calling thread (PQconnectStart/PQconnectPoll)
+        // libpq ignores connect_timeout in non-blocking mode, so the timeout is
+        // enforced here. Implementation below class definition.
+        [[nodiscard]] static net::awaitable<database_connection> async_connect(
+            std::string conn_str,
+            std::chrono::milliseconds timeout = std::chrono::seconds(30));
+
         // Disable copy, enable move
         database_connection(const database_connection&) = delete;
         database_connection& operator=(const database_connection&) = delete;
         
         database_connection(database_connection&& other) noexcept
             : conn_(std::exchange(other.conn_, nullptr))
-            , ioc_(std::exchange(other.ioc_, nullptr)) {}
+            , ioc_(std::exchange(other.ioc_, nullptr))
+            , prepared_statements_(std::move(other.prepared_statements_))
+            , round_trips_(std::exchange(other.round_trips_, {})) {}
         
         database_connection& operator=(database_connection&& other) noexcept {
             if (this != &other) {
                 close();
                 conn_ = std::exchange(other.conn_, nullptr);
                 ioc_ = std::exchange(other.ioc_, nullptr);
+                prepared_statements_ = std::move(other.prepared_statements_);
+                round_trips_ = std::exchange(other.round_trips_, {});
             }
             return *this;
         }
@@ -115,12 +195,29 @@ namespace fenrir {
             return static_cast<connection_status>(PQstatus(conn_));
         }
 
+        // Transaction state as last reported by the server; no round trip
+        [[nodiscard]] PGTransactionStatusType transaction_status() const noexcept {
+            return conn_ ? PQtransactionStatus(conn_) : PQTRANS_UNKNOWN;
+        }
+
+        // Server round trips made so far and the time spent waiting on them
+        // A pipeline sync counts as one round trip.
+        struct round_trip_stats {
+            std::uint64_t count = 0;
+            std::chrono::steady_clock::duration total{};
+        };
+
+        [[nodiscard]] round_trip_stats round_trips() const noexcept {
+            return round_trips_;
+        }
+
         // Execute a simple query (no parameters)
         [[nodiscard]] PGresult* execute(std::string_view query) {
             if (!is_connected()) {
                 throw database_error{"Connection is not valid"};
             }
 
+            round_trip_timer timer(*this);
             PGresult* result = PQexec(conn_, query.data());
             if (!result) {
                 throw database_error{
@@ -157,6 +254,7 @@ namespace fenrir {
                 param_ptrs.push_back(val.c_str());
             }
 
+            round_trip_timer timer(*this);
             PGresult* result = PQexecParams(
                 conn_,
                 query.data(),
@@ -185,6 +283,95 @@ namespace fenrir {
             return result;
         }
 
+        // Execute parameterized query with pre-encoded parameters
+        // types/lengths/formats follow PQexecParams: nullptr means inferred/text
+        [[nodiscard]] PGresult* execute_params_raw(
+            std::string_view query, int param_count, const Oid* types,
+            const char* const* values, const int* lengths, const int* formats) {
+            
+            if (!is_connected()) {
+                throw database_error{"Connection is not valid"};
+            }
+
+            std::string sql(query);
+            round_trip_timer timer(*this);
+            PGresult* result = PQexecParams(
+                conn_, sql.c_str(), param_count, types, values, lengths, formats, 0);
+            return check_result(result, "Parameterized query execution");
+        }
+
+        // Prepare a named statement on this connection (synchronous)
+        // param_types may be empty to let the server infer every parameter type
+        void prepare(std::string_view name, std::string_view query,
+                     std::span<const Oid> param_types = {}) {
+            if (!is_connected()) {
+                throw database_error{"Connection is not valid"};
+            }
+
+            std::string stmt_name(name);
+            std::string stmt_query(query);
+            round_trip_timer timer(*this);
+            PGresult* result = PQprepare(
+                conn_,
+                stmt_name.c_str(),
+                stmt_query.c_str(),
+                static_cast<int>(param_types.size()),
+                param_types.empty() ? nullptr : param_types.data()
+            );
+            PQclear(check_result(result, "Prepare"));
+
+            prepared_statements_.insert_or_assign(std::move(stmt_name), std::move(stmt_query));
+        }
+
+        // Check whether a statement with this name was prepared on this session
+        [[nodiscard]] bool is_prepared(std::string_view name) const {
+            return prepared_statements_.contains(std::string(name));
+        }
+
+        // Describe a prepared statement (parameter and result column metadata)
+        [[nodiscard]] PGresult* describe_prepared(std::string_view name) {
+            if (!is_connected()) {
+                throw database_error{"Connection is not valid"};
+            }
+
+            std::string stmt_name(name);
+            round_trip_timer timer(*this);
+            return check_result(PQdescribePrepared(conn_, stmt_name.c_str()), "Describe prepared");
+        }
+
+        // Execute prepared statement with text parameters
+        template<typename... Args>
+        [[nodiscard]] PGresult* execute_prepared(std::string_view name, Args&&... args) {
+            std::vector<std::string> param_values;
+            std::vector<const char*> param_ptrs;
+            
+            (param_values.push_back(to_string(std::forward<Args>(args))), ...);
+            
+            for (const auto& val : param_values) {
+                param_ptrs.push_back(val.c_str());
+            }
+
+            return execute_prepared_raw(name, static_cast<int>(param_ptrs.size()),
+                                        param_ptrs.data(), nullptr, nullptr);
+        }
+
+        // Execute prepared statement with pre-encoded parameters
+        // lengths/formats follow PQexecPrepared: nullptr means all-text parameters
+        [[nodiscard]] PGresult* execute_prepared_raw(
+            std::string_view name, int param_count, const char* const* values,
+            const int* lengths, const int* formats) {
+            
+            if (!is_connected()) {
+                throw database_error{"Connection is not valid"};
+            }
+
+            std::string stmt_name(name);
+            round_trip_timer timer(*this);
+            PGresult* result = PQexecPrepared(
+                conn_, stmt_name.c_str(), param_count, values, lengths, formats, 0);
+            return check_result(result, "Prepared statement execution");
+        }
+
         // Get last error message
         [[nodiscard]] std::string last_error() const {
             return conn_ ? PQerrorMessage(conn_) : "No connection";
@@ -219,10 +406,12 @@ namespace fenrir {
             return conn_;
         }
 
-        // Reset connection
+        // Reset connection (server-side session state, including prepared
+        // statements, does not survive a reset)
         void reset() {
             if (conn_) {
                 PQreset(conn_);
+                prepared_statements_.clear();
             }
         }
 
@@ -232,6 +421,7 @@ namespace fenrir {
                 PQfinish(conn_);
                 conn_ = nullptr;
             }
+            prepared_statements_.clear();
         }
 
         // === ASYNC METHODS (require io_context) ===
@@ -256,14 +446,51 @@ namespace fenrir {
 
         // Async prepare statement (implementation below class definition)
         [[nodiscard]] net::awaitable<void> async_prepare(
-            std::string_view name, std::string_view query);
+            std::string_view name, std::string_view query,
+            std::span<const Oid> param_types = {});
 
         // Async execute prepared statement (implementation below class definition)
         template<typename... Args>
         [[nodiscard]] net::awaitable<query_result> async_execute_prepared(
             std::string_view name, Args&&... args);
 
+        // Async execute prepared statement with pre-encoded parameters
+        // The parameter buffers only need to stay valid until the call suspends
+        [[nodiscard]] net::awaitable<query_result> async_execute_prepared_raw(
+            std::string_view name, int param_count, const char* const* values,
+            const int* lengths, const int* formats);
+
     private:
+        friend class database_pipeline;
+        friend class database_transaction;
+        friend class session_multiplexer;
+        friend class multiplexed_transaction;
+
+        // Take ownership of a connection started with PQconnectStart
+        explicit database_connection(PGconn* started) noexcept : conn_(started) {}
+
+        // Drive PQconnectPoll until the connection is up (runs on a strand)
+        [[nodiscard]] net::awaitable<void> poll_connect(std::chrono::milliseconds timeout);
+
+        // Adds the time until it is destroyed to round_trips_
+        class round_trip_timer {
+        public:
+            explicit round_trip_timer(database_connection& conn) noexcept
+                : conn_(conn), start_(std::chrono::steady_clock::now()) {}
+
+            ~round_trip_timer() {
+                ++conn_.round_trips_.count;
+                conn_.round_trips_.total += std::chrono::steady_clock::now() - start_;
+            }
+
+            round_trip_timer(const round_trip_timer&) = delete;
+            round_trip_timer& operator=(const round_trip_timer&) = delete;
+
+        private:
+            database_connection& conn_;
+            std::chrono::steady_clock::time_point start_;
+        };
+
         void connect(std::string_view conn_str) {
             conn_ = PQconnectdb(conn_str.data());
             if (!is_connected()) {
@@ -273,6 +500,26 @@ namespace fenrir {
             }
         }
 
+        // Validate a synchronous result, clearing it and throwing on failure
+        [[nodiscard]] PGresult* check_result(PGresult* result, std::string_view what) {
+            if (!result) {
+                throw database_error{
+                    std::format("{} failed: {}", what, PQerrorMessage(conn_))
+                };
+            }
+
+            ExecStatusType status = PQresultStatus(result);
+            if (status != PGRES_COMMAND_OK && status != PGRES_TUPLES_OK) {
+                std::string error_msg = PQresultErrorMessage(result);
+                const char* state = PQresultErrorField(result, PG_DIAG_SQLSTATE);
+                std::string sql_state = state ? state : "";
+                PQclear(result);
+                throw database_error{std::move(error_msg), std::move(sql_state)};
+            }
+
+            return result;
+        }
+
         // Helper to convert arguments to strings
         template<typename T>
         static std::string to_string(T&& value) {
@@ -295,6 +542,9 @@ namespace fenrir {
                 return std::to_string(value);
             } else if constexpr (std::is_same_v<DecayedT, bool>) {
                 return value ? "true" : "false";
+            } else if constexpr (detail::array_param<DecayedT>) {
+                // std::vector, std::span, ... become array literals ({1,2,3})
+                return detail::array_literal(value);
             } else {
                 // Try to use std::format for other types
                 return std::format("{}", value);
@@ -304,6 +554,7 @@ namespace fenrir {
         // Wait for query result asynchronously using socket-based waiting
         // This is much more efficient than polling - it waits for actual socket activity
         [[nodiscard]] net::awaitable<PGresult*> wait_for_result() {
+            round_trip_timer timer(*this);
             auto executor = co_await net::this_coro::executor;
             
             // Get the socket file descriptor from PostgreSQL connection
@@ -365,6 +616,156 @@ namespace fenrir {
 
         PGconn* conn_{nullptr};
         net::io_context* ioc_{nullptr};
+        std::unordered_map<std::string, std::string> prepared_statements_;  // name -> SQL
+        round_trip_stats round_trips_;
+    };
+
+    struct pipeline_outcome;
+
+    // Batch several statements into a single network round trip using libpq
+    // pipeline mode (libpq 14+). Statements are queued with send_*() and their
+    // results collected by sync(). Statements between syncs run in one implicit
+    // transaction unless an explicit transaction is open.
+    class database_pipeline {
+    public:
+        explicit database_pipeline(database_connection& conn) : conn_(conn) {
+            if (!conn_.is_connected()) {
+                throw database_error{"Connection is not valid"};
+            }
+            if (!PQenterPipelineMode(conn_.native_handle())) {
+                throw database_error{
+                    std::format("Failed to enter pipeline mode: {}", conn_.last_error())
+                };
+            }
+        }
+
+        ~database_pipeline() {
+            try {
+                if (!queued_.empty()) {
+                    (void)sync();
+                }
+            } catch (...) {
+                // Ignore errors in destructor
+            }
+            PQexitPipelineMode(conn_.native_handle());
+        }
+
+        // Disable copy and move
+        database_pipeline(const database_pipeline&) = delete;
+        database_pipeline& operator=(const database_pipeline&) = delete;
+
+        // Queue a statement without parameters
+        void send(std::string_view sql) {
+            send_raw(sql, 0, nullptr, nullptr, nullptr, nullptr);
+        }
+
+        // Queue a parameterized statement (text parameters)
+        template<typename... Args>
+        void send_params(std::string_view sql, Args&&... args) {
+            std::vector<std::string> param_values;
+            std::vector<const char*> param_ptrs;
+            
+            (param_values.push_back(database_connection::to_string(std::forward<Args>(args))), ...);
+            
+            for (const auto& val : param_values) {
+                param_ptrs.push_back(val.c_str());
+            }
+
+            send_raw(sql, static_cast<int>(param_ptrs.size()), nullptr,
+                     param_ptrs.data(), nullptr, nullptr);
+        }
+
+        // Queue a statement with pre-encoded parameters
+        void send_raw(std::string_view sql, int param_count, const Oid* types,
+                      const char* const* values, const int* lengths, const int* formats) {
+            std::string query(sql);
+            if (!PQsendQueryParams(conn_.native_handle(), query.c_str(), param_count,
+                                   types, values, lengths, formats, 0)) {
+                throw database_error{
+                    std::format("Failed to queue pipelined query: {}", conn_.last_error())
+                };
+            }
+            queued_.push_back({.keep_result = true});
+        }
+
+        // Queue execution of a prepared statement with pre-encoded parameters
+        void send_prepared_raw(std::string_view name, int param_count, const char* const* values,
+                               const int* lengths, const int* formats) {
+            std::string stmt_name(name);
+            if (!PQsendQueryPrepared(conn_.native_handle(), stmt_name.c_str(), param_count,
+                                     values, lengths, formats, 0)) {
+                throw database_error{
+                    std::format("Failed to queue pipelined prepared query: {}", conn_.last_error())
+                };
+            }
+            queued_.push_back({.keep_result = true});
+        }
+
+        // Queue a statement preparation; its (empty) result is not returned by sync()
+        void send_prepare(std::string_view name, std::string_view sql,
+                          std::span<const Oid> param_types = {}) {
+            std::string stmt_name(name);
+            std::string query(sql);
+            if (!PQsendPrepare(conn_.native_handle(), stmt_name.c_str(), query.c_str(),
+                               static_cast<int>(param_types.size()),
+                               param_types.empty() ? nullptr : param_types.data())) {
+                throw database_error{
+                    std::format("Failed to queue pipelined prepare: {}", conn_.last_error())
+                };
+            }
+            queued_.push_back({
+                .keep_result = false,
+                .prepare_index = static_cast<int>(prepares_.size())
+            });
+            prepares_.emplace_back(std::move(stmt_name), std::move(query));
+        }
+
+        // Number of queued statements awaiting sync()
+        [[nodiscard]] std::size_t pending() const noexcept {
+            return queued_.size();
+        }
+
+        // Flush the pipeline and collect one result per queued statement
+        // Throws the first statement error after the whole pipeline is drained.
+        [[nodiscard]] std::vector<query_result> sync();
+
+        // sync() without blocking: waits for the results on the socket
+        [[nodiscard]] net::awaitable<std::vector<query_result>> async_sync();
+
+        // sync() that reports every statement's own outcome instead of
+        // throwing the first error
+        [[nodiscard]] std::vector<pipeline_outcome> sync_each();
+
+    private:
+        struct queued_statement {
+            bool keep_result;        // return its result from sync()
+            int prepare_index = -1;  // index into prepares_ for send_prepare()
+        };
+
+        // Every PGresult up to and including the sync marker, in arrival
+        // order; a null entry ends each statement's results
+        using raw_results = std::vector<std::unique_ptr<PGresult, decltype(&PQclear)>>;
+
+        void send_sync();
+
+        // Store a result read after send_sync(); true once the sync marker (or
+        // the end of all results, if the connection failed) was read
+        static bool add_result(raw_results& raw, PGresult* result);
+
+        struct drained_results {
+            std::vector<pipeline_outcome> outcomes;     // One per statement whose result is kept
+            std::optional<database_error> first_error;  // Including failed prepares
+        };
+
+        // Match the drained results to the queued statements
+        drained_results drain(raw_results raw);
+
+        // drain(), throwing the first error
+        std::vector<query_result> collect(raw_results raw);
+
+        database_connection& conn_;
+        std::vector<queued_statement> queued_;
+        std::vector<std::pair<std::string, std::string>> prepares_;  // name -> SQL
     };
 
 } // namespace fenrir
@@ -374,11 +775,99 @@ namespace fenrir {
 
 namespace fenrir {
 
+    // Outcome of one pipelined statement: its result or its error
+    // A statement the server skipped because an earlier one in the same sync
+    // failed has skipped set and a placeholder error.
+    struct pipeline_outcome {
+        std::optional<query_result> result;
+        std::optional<database_error> error;
+        bool skipped = false;
+    };
+
     // ============================================================================
     // ASYNC METHOD IMPLEMENTATIONS
     // ============================================================================
     // These are defined after query_result is fully available
     
+    inline net::awaitable<database_connection> database_connection::async_connect(
+        std::string conn_str, std::chrono::milliseconds timeout) {
+        
+        database_connection conn(PQconnectStart(conn_str.c_str()));
+        if (!conn.conn_) {
+            throw database_error{"Failed to connect to database: out of memory"};
+        }
+        if (PQstatus(conn.conn_) == CONNECTION_BAD) {
+            throw database_error{std::format("Failed to connect to database: {}", conn.last_error())};
+        }
+        
+        // The timer and the socket waits must not run concurrently, so the
+        // handshake is driven on a strand of the caller's executor
+        auto executor = co_await net::this_coro::executor;
+        co_await net::co_spawn(net::make_strand(executor), conn.poll_connect(timeout), net::use_awaitable);
+        co_return conn;
+    }
+
+    inline net::awaitable<void> database_connection::poll_connect(std::chrono::milliseconds timeout) {
+        auto executor = co_await net::this_coro::executor;
+        
+        // Shared with the timer handler, which may run after this frame is gone
+        struct wait_state {
+            net::ip::tcp::socket* socket = nullptr;
+            bool timed_out = false;
+        };
+        auto state = std::make_shared<wait_state>();
+        
+        net::steady_timer timer(executor, timeout);
+        timer.async_wait([state](boost::system::error_code ec) {
+            if (ec) return;
+            state->timed_out = true;
+            if (state->socket) {
+                boost::system::error_code ignored;
+                state->socket->cancel(ignored);
+            }
+        });
+        struct timer_guard {
+            net::steady_timer& timer;
+            ~timer_guard() { timer.cancel(); }
+        } guard{timer};
+        
+        // Right after PQconnectStart, behave as if polling returned WRITING
+        PostgresPollingStatusType poll = PGRES_POLLING_WRITING;
+        while (poll != PGRES_POLLING_OK) {
+            if (poll == PGRES_POLLING_FAILED) {
+                throw database_error{std::format("Failed to connect to database: {}", last_error())};
+            }
+            
+            // The socket can change between polls (e.g. when trying several hosts)
+            auto socket_fd = PQsocket(conn_);
+            if (socket_fd < 0) {
+                throw database_error{"Invalid socket from PostgreSQL connection"};
+            }
+            
+            net::ip::tcp::socket socket(executor);
+            socket.assign(net::ip::tcp::v4(), socket_fd);
+            struct socket_releaser {
+                net::ip::tcp::socket& sock;
+                wait_state& state;
+                ~socket_releaser() {
+                    state.socket = nullptr;
+                    sock.release();
+                }
+            } releaser{socket, *state};
+            state->socket = &socket;
+            
+            boost::system::error_code ec;
+            co_await socket.async_wait(
+                poll == PGRES_POLLING_READING ? net::socket_base::wait_read : net::socket_base::wait_write,
+                net::redirect_error(net::use_awaitable, ec));
+            
+            if (state->timed_out) {
+                throw database_error{"Failed to connect to database: timeout expired"};
+            }
+            poll = PQconnectPoll(conn_);
+        }
+    }
+
     inline net::awaitable<query_result> database_connection::async_execute(std::string_view query) {
         if (!is_connected()) {
             throw database_error{"Connection is not valid"};
@@ -438,7 +927,7 @@ namespace fenrir {
     }
 
     inline net::awaitable<void> database_connection::async_prepare(
-        std::string_view name, std::string_view query) {
+        std::string_view name, std::string_view query, std::span<const Oid> param_types) {
         
         if (!is_connected()) {
             throw database_error{"Connection is not valid"};
@@ -447,7 +936,11 @@ namespace fenrir {
             throw database_error{"io_context not set. Call set_io_context() first."};
         }
 
-        if (!PQsendPrepare(native_handle(), name.data(), query.data(), 0, nullptr)) {
+        std::string stmt_name(name);
+        std::string stmt_query(query);
+        if (!PQsendPrepare(native_handle(), stmt_name.c_str(), stmt_query.c_str(),
+                           static_cast<int>(param_types.size()),
+                           param_types.empty() ? nullptr : param_types.data())) {
             throw database_error{
                 std::format("Failed to send async prepare: {}", last_error())
             };
@@ -464,6 +957,7 @@ namespace fenrir {
         }
         
         PQclear(result);
+        prepared_statements_.insert_or_assign(std::move(stmt_name), std::move(stmt_query));
         co_return;
     }
 
@@ -503,4 +997,173 @@ namespace fenrir {
         co_return query_result(co_await wait_for_result());
     }
 
+    inline net::awaitable<query_result> database_connection::async_execute_prepared_raw(
+        std::string_view name, int param_count, const char* const* values,
+        const int* lengths, const int* formats) {
+        
+        if (!is_connected()) {
+            throw database_error{"Connection is not valid"};
+        }
+        if (!ioc_) {
+            throw database_error{"io_context not set. Call set_io_context() first."};
+        }
+
+        std::string stmt_name(name);
+        if (!PQsendQueryPrepared(
+            native_handle(), stmt_name.c_str(), param_count, values, lengths, formats, 0)) {
+            throw database_error{
+                std::format("Failed to send async prepared query: {}", last_error())
+            };
+        }
+
+        co_return query_result(co_await wait_for_result());
+    }
+
+    // ============================================================================
+    // PIPELINE IMPLEMENTATION
+    // ============================================================================
+
+    inline void database_pipeline::send_sync() {
+        if (!PQpipelineSync(conn_.native_handle())) {
+            throw database_error{
+                std::format("Failed to sync pipeline: {}", conn_.last_error())
+            };
+        }
+    }
+
+    inline bool database_pipeline::add_result(raw_results& raw, PGresult* result) {
+        // Two nulls in a row: no statement has results left to return
+        bool exhausted = !result && !raw.empty() && !raw.back();
+        bool marker = result && PQresultStatus(result) == PGRES_PIPELINE_SYNC;
+        raw.emplace_back(result, PQclear);
+        return marker || exhausted;
+    }
+
+    inline std::vector<query_result> database_pipeline::sync() {
+        database_connection::round_trip_timer timer(conn_);
+        send_sync();
+
+        raw_results raw;
+        while (!add_result(raw, PQgetResult(conn_.native_handle()))) {}
+        return collect(std::move(raw));
+    }
+
+    inline net::awaitable<std::vector<query_result>> database_pipeline::async_sync() {
+        database_connection::round_trip_timer timer(conn_);
+        send_sync();
+
+        PGconn* pg = conn_.native_handle();
+        auto executor = co_await net::this_coro::executor;
+        net::ip::tcp::socket socket(executor);
+        socket.assign(net::ip::tcp::v4(), PQsocket(pg));
+        struct socket_releaser {
+            net::ip::tcp::socket& sock;
+            ~socket_releaser() { sock.release(); }
+        } releaser{socket};
+
+        raw_results raw;
+        while (true) {
+            if (PQconsumeInput(pg) == 0) {
+                throw database_error{
+                    std::format("Failed to consume input: {}", conn_.last_error())
+                };
+            }
+            // PQgetResult only blocks while PQisBusy
+            bool done = false;
+            while (!done && !PQisBusy(pg)) {
+                done = add_result(raw, PQgetResult(pg));
+            }
+            if (done) break;
+            co_await socket.async_wait(net::socket_base::wait_read, net::use_awaitable);
+        }
+        co_return collect(std::move(raw));
+    }
+
+    inline std::vector<pipeline_outcome> database_pipeline::sync_each() {
+        database_connection::round_trip_timer timer(conn_);
+        send_sync();
+
+        raw_results raw;
+        while (!add_result(raw, PQgetResult(conn_.native_handle()))) {}
+        return drain(std::move(raw)).outcomes;
+    }
+
+    inline database_pipeline::drained_results database_pipeline::drain(raw_results raw) {
+        auto queued = std::exchange(queued_, {});
+        auto prepares = std::exchange(prepares_, {});
+
+        drained_results drained;
+        drained.outcomes.reserve(queued.size());
+        size_t next = 0;
+        auto take = [&]() -> PGresult* {
+            return next < raw.size() ? raw[next++].release() : nullptr;
+        };
+
+        for (const auto& entry : queued) {
+            pipeline_outcome outcome;
+            PGresult* result = take();
+            if (!result) {
+                outcome.error = database_error{
+                    std::format("Pipeline returned no result: {}", conn_.last_error())
+                };
+                if (!drained.first_error) {
+                    drained.first_error = outcome.error;
+                }
+                if (entry.keep_result) {
+                    drained.outcomes.push_back(std::move(outcome));
+                }
+                continue;
+            }
+
+            ExecStatusType status = PQresultStatus(result);
+            if (status == PGRES_COMMAND_OK || status == PGRES_TUPLES_OK) {
+                if (entry.prepare_index >= 0) {
+                    auto& [name, sql] = prepares[entry.prepare_index];
+                    conn_.prepared_statements_.insert_or_assign(std::move(name), std::move(sql));
+                }
+                if (entry.keep_result) {
+                    outcome.result.emplace(result);
+                } else {
+                    PQclear(result);
+                }
+            } else if (status == PGRES_PIPELINE_ABORTED) {
+                outcome.error = database_error{"Statement skipped: an earlier statement in the pipeline failed"};
+                outcome.skipped = true;
+                PQclear(result);
+            } else {
+                const char* state = PQresultErrorField(result, PG_DIAG_SQLSTATE);
+                outcome.error = database_error{PQresultErrorMessage(result), state ? state : ""};
+                if (!drained.first_error) {
+                    drained.first_error = outcome.error;
+                }
+                PQclear(result);
+            }
+            if (entry.keep_result) {
+                drained.outcomes.push_back(std::move(outcome));
+            }
+
+            // Each statement's results are terminated by a null result
+            while ((result = take()) != nullptr) {
+                PQclear(result);
+            }
+        }
+        // Whatever is left (the sync marker) is freed with raw
+
+        return drained;
+    }
+
+    inline std::vector<query_result> database_pipeline::collect(raw_results raw) {
+        auto drained = drain(std::move(raw));
+        if (drained.first_error) {
+            throw *drained.first_error;
+        }
+
+        std::vector<query_result> results;
+        results.reserve(drained.outcomes.size());
+        for (auto& outcome : drained.outcomes) {
+            results.push_back(std::move(*outcome.result));
+        }
+        return results;
+    }
+
 } // namespace fenrir
\ No newline at end of file
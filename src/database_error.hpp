@@ -0,0 +1,22 @@
+#pragma once
+
+#include <source_location>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+namespace fenrir {
+
+    // Error type for database operations
+    struct database_error : public std::runtime_error {
+        std::string sql_state;
+        std::source_location location;
+        
+        database_error(std::string msg, std::string state = "", 
+                      std::source_location loc = std::source_location::current())
+            : std::runtime_error(msg), sql_state(std::move(state)), location(loc) {}
+        
+        std::string message() const { return what(); }
+    };
+
+} // namespace fenrir
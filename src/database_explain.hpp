@@ -0,0 +1,66 @@
+#pragma once
+
+#include <libpq-fe.h>
+#include <string>
+#include <string_view>
+#include <utility>
+#include "database_query_plan.hpp"
+#include "database_connection.hpp"
+
+namespace fenrir {
+
+    // Run EXPLAIN (ANALYZE, BUFFERS, FORMAT JSON) for sql and parse the plan
+    // With options.analyze the statement is executed; unless options.rollback is
+    // false, data-modifying statements leave no trace: the statement runs inside
+    // BEGIN/ROLLBACK, or inside a savepoint that is rolled back when the caller
+    // already has a transaction open.
+    template<typename... Args>
+    [[nodiscard]] query_plan explain(database_connection& conn, std::string_view sql,
+                                     const explain_options& options, Args&&... args) {
+        std::string statement = detail::explain_sql(sql, options);
+
+        std::string_view undo;
+        if (options.analyze && options.rollback) {
+            switch (PQtransactionStatus(conn.native_handle())) {
+                case PQTRANS_IDLE:
+                    PQclear(conn.execute("BEGIN"));
+                    undo = "ROLLBACK";
+                    break;
+                case PQTRANS_INTRANS:
+                    PQclear(conn.execute("SAVEPOINT fenrir_explain"));
+                    undo = "ROLLBACK TO SAVEPOINT fenrir_explain; RELEASE SAVEPOINT fenrir_explain";
+                    break;
+                default:
+                    break;  // A failed transaction rejects the statement anyway
+            }
+        }
+
+        PGresult* result = nullptr;
+        try {
+            if constexpr (sizeof...(Args) == 0) {
+                result = conn.execute(statement);
+            } else {
+                result = conn.execute_params(statement, std::forward<Args>(args)...);
+            }
+        } catch (...) {
+            if (!undo.empty()) {
+                try { PQclear(conn.execute(undo)); } catch (...) {}
+            }
+            throw;
+        }
+
+        // One row per output line; FORMAT JSON normally returns a single row
+        std::string json;
+        for (int row = 0; row < PQntuples(result); ++row) {
+            if (row > 0) json += '\n';
+            json += PQgetvalue(result, row, 0);
+        }
+        PQclear(result);
+
+        if (!undo.empty()) {
+            PQclear(conn.execute(undo));
+        }
+        return query_plan::parse(std::move(json));
+    }
+
+} // namespace fenrir
@@ -0,0 +1,587 @@
+#pragma once
+
+#include "database_connection.hpp"
+#include "database_transaction.hpp"
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+#include <boost/asio/associated_executor.hpp>
+#include <boost/asio/async_result.hpp>
+#include <boost/asio/co_spawn.hpp>
+#include <boost/asio/detached.hpp>
+#include <boost/asio/dispatch.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/redirect_error.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/strand.hpp>
+
+namespace fenrir {
+
+    // Settings of session_multiplexer
+    struct multiplexer_config {
+        std::string connection_string;
+        size_t connections = 2;                             // Server connections shared by every session
+        size_t max_pipeline_depth = 64;                     // Statements in flight per connection before queuing
+        std::chrono::milliseconds connect_timeout{30000};
+        std::chrono::milliseconds reconnect_interval{1000}; // Pause between attempts to re-establish a connection
+        net::io_context* io_context = nullptr;              // Required; every connection is driven on it
+    };
+
+    class multiplexed_transaction;
+
+    namespace detail {
+
+        using pg_result_ptr = std::unique_ptr<PGresult, decltype(&PQclear)>;
+
+        // What a statement is and where it must run
+        struct mux_statement {
+            std::string sql;
+            std::vector<std::string> params;
+            int backend = -1;                // Pinned connection (inside a transaction), or -1 to route
+            std::uint64_t generation = 0;    // Incarnation of the pinned connection
+            bool pin = false;                // BEGIN: pin the connection it runs on
+            bool unpin = false;              // COMMIT / ROLLBACK: unpin once it completes
+        };
+
+        // Result handed back to the caller, with the connection that produced it
+        struct mux_reply {
+            pg_result_ptr result{nullptr, PQclear};
+            int backend = -1;
+            std::uint64_t generation = 0;
+        };
+
+        // A statement waiting for its result
+        // Results of a pipelined statement arrive as its PGresult, a null
+        // terminator and then the sync marker that follows every statement.
+        struct mux_request {
+            enum class stage { result, end, sync };
+
+            mux_statement statement;
+            mux_reply reply;
+            std::optional<database_error> error;
+            stage awaiting = stage::result;
+
+            virtual ~mux_request() = default;
+
+            // Hand the reply (or error) to the caller; runs on the multiplexer's strand
+            virtual void complete() = 0;
+        };
+
+        template<typename Handler>
+        class mux_request_op final : public mux_request {
+        public:
+            explicit mux_request_op(Handler handler) : handler_(std::move(handler)) {}
+
+            void complete() override {
+                auto error_ptr = error ? std::make_exception_ptr(*error) : std::exception_ptr{};
+                auto executor = net::get_associated_executor(handler_);
+                net::post(executor, [handler = std::move(handler_), error_ptr,
+                                     reply = std::move(reply)]() mutable {
+                    std::move(handler)(error_ptr, std::move(reply));
+                });
+            }
+
+        private:
+            Handler handler_;
+        };
+
+        // Fire-and-forget statement, e.g. the ROLLBACK of an abandoned transaction
+        struct detached_mux_request final : mux_request {
+            void complete() override {}
+        };
+
+        // One server connection in pipeline mode
+        struct mux_backend {
+            explicit mux_backend(const net::strand<net::io_context::executor_type>& strand)
+                : socket(strand), wake(strand) {}
+
+            std::unique_ptr<database_connection> conn;
+            net::ip::tcp::socket socket;                      // Borrows conn's descriptor
+            net::steady_timer wake;                           // The idle driver sleeps on it
+            std::deque<std::unique_ptr<mux_request>> in_flight;
+            std::uint64_t generation = 0;                     // Bumped on every (re)connect
+            bool up = false;
+            bool pinned = false;
+        };
+
+        // State shared by session_multiplexer, its transactions and the
+        // coroutines driving each connection. Everything runs on strand_.
+        class multiplexer_core : public std::enable_shared_from_this<multiplexer_core> {
+        public:
+            explicit multiplexer_core(const multiplexer_config& config)
+                : config_(config), strand_(net::make_strand(*config.io_context)) {
+                for (size_t i = 0; i < config_.connections; ++i) {
+                    backends_.push_back(std::make_unique<mux_backend>(strand_));
+                }
+            }
+
+            void start() {
+                for (size_t i = 0; i < backends_.size(); ++i) {
+                    net::co_spawn(strand_, drive(i), net::detached);
+                }
+            }
+
+            void shutdown() {
+                net::dispatch(strand_, [self = shared_from_this()] {
+                    if (std::exchange(self->closed_, true)) return;
+                    database_error error{"Multiplexer is shutting down"};
+                    self->fail_queued(error);
+                    for (auto& backend : self->backends_) {
+                        backend->wake.cancel();
+                        if (backend->socket.is_open()) backend->socket.cancel();
+                    }
+                });
+            }
+
+            // Run one statement and wait for its reply
+            net::awaitable<mux_reply> run(mux_statement statement) {
+                co_return co_await net::async_initiate<decltype(net::use_awaitable),
+                                                       void(std::exception_ptr, mux_reply)>(
+                    [self = shared_from_this()](auto handler, mux_statement statement) {
+                        auto request = std::make_unique<mux_request_op<decltype(handler)>>(std::move(handler));
+                        request->statement = std::move(statement);
+                        self->submit(std::move(request));
+                    },
+                    net::use_awaitable, std::move(statement));
+            }
+
+            // Run a statement nobody waits for
+            void run_detached(mux_statement statement) {
+                auto request = std::make_unique<detached_mux_request>();
+                request->statement = std::move(statement);
+                submit(std::move(request));
+            }
+
+        private:
+            void submit(std::unique_ptr<mux_request> request) {
+                net::dispatch(strand_, [self = shared_from_this(), request = std::move(request)]() mutable {
+                    self->route(std::move(request));
+                });
+            }
+
+            void route(std::unique_ptr<mux_request> request) {
+                auto& statement = request->statement;
+                if (closed_) {
+                    fail(*request, database_error{"Multiplexer is shutting down"});
+                } else if (statement.backend >= 0) {
+                    // Inside a transaction: only the pinned connection will do
+                    auto& backend = *backends_[statement.backend];
+                    if (!backend.up || backend.generation != statement.generation) {
+                        if (statement.unpin) backend.pinned = false;
+                        fail(*request, database_error{"Connection to server lost during transaction", "08006"});
+                        place_queued();
+                    } else {
+                        send(backend, std::move(request));
+                    }
+                } else {
+                    (statement.pin ? pin_queue_ : queue_).push_back(std::move(request));
+                    place_queued();
+                }
+            }
+
+            // Least busy connection that is up and not pinned
+            mux_backend* pick(bool for_pin) noexcept {
+                mux_backend* best = nullptr;
+                for (auto& backend : backends_) {
+                    if (!backend->up || backend->pinned) continue;
+                    if (!for_pin && backend->in_flight.size() >= config_.max_pipeline_depth) continue;
+                    if (!best || backend->in_flight.size() < best->in_flight.size()) best = backend.get();
+                }
+                return best;
+            }
+
+            // Send queued statements, transactions first, while connections have room
+            void place_queued() {
+                while (!pin_queue_.empty()) {
+                    auto* backend = pick(true);
+                    if (!backend) break;
+                    auto request = std::move(pin_queue_.front());
+                    pin_queue_.pop_front();
+                    backend->pinned = true;
+                    request->statement.backend = index_of(*backend);
+                    request->statement.generation = backend->generation;
+                    send(*backend, std::move(request));
+                }
+                while (!queue_.empty()) {
+                    auto* backend = pick(false);
+                    if (!backend) break;
+                    auto request = std::move(queue_.front());
+                    queue_.pop_front();
+                    send(*backend, std::move(request));
+                }
+            }
+
+            void send(mux_backend& backend, std::unique_ptr<mux_request> request) {
+                PGconn* pg = backend.conn->native_handle();
+                auto& statement = request->statement;
+                std::vector<const char*> values;
+                values.reserve(statement.params.size());
+                for (const auto& param : statement.params) {
+                    values.push_back(param.c_str());
+                }
+
+                if (!PQsendQueryParams(pg, statement.sql.c_str(), static_cast<int>(values.size()), nullptr,
+                                       values.data(), nullptr, nullptr, 0) ||
+                    !PQpipelineSync(pg)) {
+                    if (statement.pin || statement.unpin) backend.pinned = false;
+                    fail(*request, database_error{
+                        std::format("Failed to send multiplexed query: {}", backend.conn->last_error())});
+                    if (PQstatus(pg) == CONNECTION_BAD) lose(backend);
+                    return;
+                }
+                request->reply.backend = statement.backend;
+                request->reply.generation = backend.generation;
+                backend.in_flight.push_back(std::move(request));
+
+                // A partial write is finished by the driver once the socket is writable
+                if (PQflush(pg) != 0) backend.socket.cancel();
+                backend.wake.cancel();
+            }
+
+            // Read every complete result and finish the statements they belong to
+            void read_results(mux_backend& backend) {
+                PGconn* pg = backend.conn->native_handle();
+                while (!backend.in_flight.empty() && !PQisBusy(pg)) {
+                    auto& request = *backend.in_flight.front();
+                    PGresult* raw = PQgetResult(pg);
+                    if (!raw) {
+                        if (request.awaiting != mux_request::stage::end) break;  // Nothing more yet
+                        request.awaiting = mux_request::stage::sync;
+                        continue;
+                    }
+
+                    pg_result_ptr result(raw, PQclear);
+                    ExecStatusType status = PQresultStatus(raw);
+                    if (status == PGRES_PIPELINE_SYNC) {
+                        finish(backend);
+                        continue;
+                    }
+                    if (request.awaiting != mux_request::stage::result) continue;
+
+                    request.awaiting = mux_request::stage::end;
+                    if (status == PGRES_COMMAND_OK || status == PGRES_TUPLES_OK) {
+                        request.reply.result = std::move(result);
+                    } else {
+                        const char* state = PQresultErrorField(raw, PG_DIAG_SQLSTATE);
+                        request.error = database_error{PQresultErrorMessage(raw), state ? state : ""};
+                    }
+                }
+            }
+
+            void finish(mux_backend& backend) {
+                auto request = std::move(backend.in_flight.front());
+                backend.in_flight.pop_front();
+                const auto& statement = request->statement;
+                if (statement.unpin || (statement.pin && request->error)) {
+                    backend.pinned = false;
+                }
+                request->complete();
+                place_queued();
+            }
+
+            // The connection broke: fail whatever it had in flight
+            void lose(mux_backend& backend) {
+                backend.up = false;
+                auto lost = std::exchange(backend.in_flight, {});
+                database_error error{
+                    std::format("Connection to server lost: {}", backend.conn->last_error()), "08006"};
+                for (auto& request : lost) {
+                    if (request->statement.unpin || request->statement.pin) backend.pinned = false;
+                    fail(*request, error);
+                }
+                backend.wake.cancel();
+            }
+
+            void fail(mux_request& request, const database_error& error) {
+                request.error = error;
+                request.complete();
+            }
+
+            void fail_queued(const database_error& error) {
+                auto queued = std::exchange(queue_, {});
+                auto pinning = std::exchange(pin_queue_, {});
+                for (auto& request : queued) fail(*request, error);
+                for (auto& request : pinning) fail(*request, error);
+            }
+
+            int index_of(const mux_backend& backend) const noexcept {
+                for (size_t i = 0; i < backends_.size(); ++i) {
+                    if (backends_[i].get() == &backend) return static_cast<int>(i);
+                }
+                return -1;
+            }
+
+            [[nodiscard]] bool any_up() const noexcept {
+                for (const auto& backend : backends_) {
+                    if (backend->up) return true;
+                }
+                return false;
+            }
+
+            // (Re)establish a connection; on failure, fail the queue if no
+            // connection is left to serve it, then pause before the next attempt
+            net::awaitable<void> connect(mux_backend& backend) {
+                if (backend.socket.is_open()) backend.socket.release();
+                backend.conn.reset();
+
+                std::optional<database_error> error;
+                try {
+                    auto conn = co_await database_connection::async_connect(
+                        config_.connection_string, config_.connect_timeout);
+                    PGconn* pg = conn.native_handle();
+                    if (PQsetnonblocking(pg, 1) != 0 || !PQenterPipelineMode(pg)) {
+                        throw database_error{
+                            std::format("Failed to enter pipeline mode: {}", conn.last_error())};
+                    }
+                    backend.conn = std::make_unique<database_connection>(std::move(conn));
+                    backend.socket.assign(net::ip::tcp::v4(), PQsocket(pg));
+                } catch (const database_error& e) {
+                    error = e;
+                } catch (const std::exception& e) {
+                    error = database_error{e.what()};
+                }
+                if (closed_) co_return;
+
+                if (!error) {
+                    ++backend.generation;
+                    backend.up = true;
+                    place_queued();
+                    co_return;
+                }
+                backend.conn.reset();
+                if (!any_up()) fail_queued(*error);
+
+                boost::system::error_code ec;
+                backend.wake.expires_after(config_.reconnect_interval);
+                co_await backend.wake.async_wait(net::redirect_error(net::use_awaitable, ec));
+            }
+
+            // Wait until the socket is readable or writable
+            // libpq needs both while a partial write is pending: the server may
+            // stop reading our queries until we read its results.
+            static net::awaitable<void> wait_readable_or_writable(net::ip::tcp::socket& socket) {
+                co_await net::async_initiate<decltype(net::use_awaitable), void()>(
+                    [&socket](auto handler) {
+                        struct wait_state {
+                            decltype(handler) resume;
+                            int pending = 2;
+                            bool fired = false;
+                        };
+                        auto state = std::make_shared<wait_state>(std::move(handler));
+                        auto done = [state, &socket](boost::system::error_code) {
+                            if (!std::exchange(state->fired, true)) {
+                                boost::system::error_code ignored;
+                                socket.cancel(ignored);
+                            }
+                            if (--state->pending == 0) std::move(state->resume)();
+                        };
+                        socket.async_wait(net::socket_base::wait_read, done);
+                        socket.async_wait(net::socket_base::wait_write, done);
+                    },
+                    net::use_awaitable);
+            }
+
+            // Send, flush and read for one connection until shutdown
+            net::awaitable<void> drive(size_t index) {
+                auto self = shared_from_this();
+                auto& backend = *backends_[index];
+
+                while (!closed_) {
+                    if (!backend.up) {
+                        co_await connect(backend);
+                        continue;
+                    }
+
+                    boost::system::error_code ec;
+                    if (backend.in_flight.empty()) {
+                        backend.wake.expires_at(net::steady_timer::time_point::max());
+                        co_await backend.wake.async_wait(net::redirect_error(net::use_awaitable, ec));
+                        continue;
+                    }
+
+                    PGconn* pg = backend.conn->native_handle();
+                    int flushed = PQflush(pg);
+                    if (flushed < 0) {
+                        lose(backend);
+                        continue;
+                    } else if (flushed > 0) {
+                        co_await wait_readable_or_writable(backend.socket);
+                    } else {
+                        co_await backend.socket.async_wait(net::socket_base::wait_read,
+                                                           net::redirect_error(net::use_awaitable, ec));
+                        if (ec == net::error::operation_aborted) continue;  // New statements to flush
+                    }
+                    if (closed_) break;
+
+                    if (ec || !PQconsumeInput(pg)) {
+                        lose(backend);
+                        continue;
+                    }
+                    read_results(backend);
+                }
+
+                // Shut down: nothing more will be read
+                if (backend.conn) {
+                    auto lost = std::exchange(backend.in_flight, {});
+                    database_error error{"Multiplexer is shutting down"};
+                    for (auto& request : lost) fail(*request, error);
+                    if (backend.socket.is_open()) backend.socket.release();
+                    backend.conn.reset();
+                }
+                backend.up = false;
+            }
+
+            multiplexer_config config_;
+            net::strand<net::io_context::executor_type> strand_;
+            std::vector<std::unique_ptr<mux_backend>> backends_;
+            std::deque<std::unique_ptr<mux_request>> queue_;      // Statements waiting for room on a connection
+            std::deque<std::unique_ptr<mux_request>> pin_queue_;  // BEGINs waiting for a connection to pin
+            bool closed_ = false;
+        };
+
+    } // namespace detail
+
+    // Transaction pinned to one of a session_multiplexer's connections
+    // The connection serves nothing else from BEGIN until COMMIT or ROLLBACK.
+    // Destroying an active transaction rolls it back without waiting.
+    class multiplexed_transaction {
+    public:
+        multiplexed_transaction(multiplexed_transaction&& other) noexcept
+            : core_(std::move(other.core_)),
+              backend_(other.backend_),
+              generation_(other.generation_),
+              active_(std::exchange(other.active_, false)) {}
+
+        multiplexed_transaction(const multiplexed_transaction&) = delete;
+        multiplexed_transaction& operator=(const multiplexed_transaction&) = delete;
+        multiplexed_transaction& operator=(multiplexed_transaction&&) = delete;
+
+        ~multiplexed_transaction() {
+            if (active_) {
+                core_->run_detached(statement("ROLLBACK", true));
+            }
+        }
+
+        [[nodiscard]] net::awaitable<query_result> async_execute(std::string_view sql) {
+            check_active();
+            auto reply = co_await core_->run(statement(sql, false));
+            co_return query_result(reply.result.release());
+        }
+
+        template<typename... Args>
+        [[nodiscard]] net::awaitable<query_result> async_execute_params(std::string_view sql, Args&&... args) {
+            check_active();
+            auto stmt = statement(sql, false);
+            (stmt.params.push_back(database_connection::to_string(std::forward<Args>(args))), ...);
+            auto reply = co_await core_->run(std::move(stmt));
+            co_return query_result(reply.result.release());
+        }
+
+        net::awaitable<void> async_commit() {
+            check_active();
+            active_ = false;
+            (void)co_await core_->run(statement("COMMIT", true));
+        }
+
+        net::awaitable<void> async_rollback() {
+            check_active();
+            active_ = false;
+            (void)co_await core_->run(statement("ROLLBACK", true));
+        }
+
+        [[nodiscard]] bool is_active() const noexcept { return active_; }
+
+    private:
+        friend class session_multiplexer;
+
+        multiplexed_transaction(std::shared_ptr<detail::multiplexer_core> core, int backend,
+                                std::uint64_t generation) noexcept
+            : core_(std::move(core)), backend_(backend), generation_(generation), active_(true) {}
+
+        void check_active() const {
+            if (!active_) {
+                throw database_error{"Transaction already finalized"};
+            }
+        }
+
+        [[nodiscard]] detail::mux_statement statement(std::string_view sql, bool unpin) const {
+            return {.sql = std::string(sql), .params = {}, .backend = backend_, .generation = generation_,
+                    .pin = false, .unpin = unpin};
+        }
+
+        std::shared_ptr<detail::multiplexer_core> core_;
+        int backend_ = -1;
+        std::uint64_t generation_ = 0;
+        bool active_ = false;
+    };
+
+    // Transaction-mode pooling in process, like pgbouncer without the extra hop
+    // Any number of coroutines share a few server connections. Each statement
+    // is pipelined onto the least busy connection and followed by its own sync,
+    // so statements from different callers are independent implicit
+    // transactions and one failure never aborts another. async_begin() pins a
+    // connection for the length of an explicit transaction; statements that
+    // find every connection pinned or full wait in FIFO order.
+    class session_multiplexer {
+    public:
+        explicit session_multiplexer(const multiplexer_config& config) {
+            if (!config.io_context) {
+                throw database_error{"session_multiplexer needs an io_context"};
+            }
+            if (config.connections == 0) {
+                throw database_error{"session_multiplexer needs at least one connection"};
+            }
+            core_ = std::make_shared<detail::multiplexer_core>(config);
+            core_->start();
+        }
+
+        ~session_multiplexer() {
+            shutdown();
+        }
+
+        session_multiplexer(const session_multiplexer&) = delete;
+        session_multiplexer& operator=(const session_multiplexer&) = delete;
+
+        [[nodiscard]] net::awaitable<query_result> async_execute(std::string_view sql) {
+            auto reply = co_await core_->run(
+                {.sql = std::string(sql), .params = {}, .backend = -1, .generation = 0, .pin = false, .unpin = false});
+            co_return query_result(reply.result.release());
+        }
+
+        template<typename... Args>
+        [[nodiscard]] net::awaitable<query_result> async_execute_params(std::string_view sql, Args&&... args) {
+            detail::mux_statement stmt{
+                .sql = std::string(sql), .params = {}, .backend = -1, .generation = 0, .pin = false, .unpin = false};
+            (stmt.params.push_back(database_connection::to_string(std::forward<Args>(args))), ...);
+            auto reply = co_await core_->run(std::move(stmt));
+            co_return query_result(reply.result.release());
+        }
+
+        // Pin a connection and open a transaction on it
+        [[nodiscard]] net::awaitable<multiplexed_transaction> async_begin(
+            isolation_level level = isolation_level::read_committed,
+            access_mode mode = access_mode::read_write) {
+
+            auto reply = co_await core_->run({.sql = begin_statement(level, mode), .params = {}, .backend = -1,
+                                              .generation = 0, .pin = true, .unpin = false});
+            co_return multiplexed_transaction(core_, reply.backend, reply.generation);
+        }
+
+        // Fail queued and in-flight statements and close the connections
+        void shutdown() {
+            if (core_) core_->shutdown();
+        }
+
+    private:
+        std::shared_ptr<detail::multiplexer_core> core_;
+    };
+
+} // namespace fenrir
@@ -1,37 +1,420 @@
 #pragma once
 
 #include "database_connection.hpp"
+#include "database_pool_metrics.hpp"
+#include "database_concurrency_limit.hpp"
+#include "database_circuit_breaker.hpp"
+#include "database_retry.hpp"
 #include <memory>
 #include <mutex>
+#include <optional>
 #include <condition_variable>
-#include <queue>
 #include <vector>
 #include <atomic>
+#include <algorithm>
+#include <array>
+#include <bit>
 #include <chrono>
+#include <cstdint>
 #include <thread>
+#include <tuple>
 #include <semaphore>
+#include <stop_token>
+#include <random>
 #include <functional>
 #include <iostream>
+#include <utility>
 #include <boost/asio/io_context.hpp>
 #include <boost/asio/steady_timer.hpp>
 #include <boost/asio/post.hpp>
+#include <boost/asio/dispatch.hpp>
+#include <boost/asio/strand.hpp>
+#include <boost/asio/redirect_error.hpp>
+#include <boost/version.hpp>
 
 namespace fenrir {
 
+    class database_pool;
+
+    // Order in which idle connections are handed out
+    enum class reuse_policy {
+        fifo,               // Least recently used first; spreads load over every connection
+        lifo,               // Most recently used first; a small hot set serves most requests
+        statement_affinity  // LIFO, and acquire_for() prefers a connection that prepared the statement
+    };
+
+    // The pool had no connection to hand out in time: the acquire timed out
+    // or was turned away by the adaptive concurrency limit. Unlike other
+    // acquire errors, it says nothing about the server being reachable.
+    struct pool_busy_error : database_error {
+        using database_error::database_error;
+    };
+
+    // Scheduling class of a caller waiting for a connection
+    enum class acquire_priority {
+        interactive,  // User-facing requests
+        normal,
+        batch         // Background jobs; served with what is left
+    };
+
+    namespace detail {
+
+        // Bounded lock-free MPMC queue of slot indices (Vyukov)
+        // Each cell carries a sequence number: a producer may write a cell when
+        // sequence == position, a consumer may read it when sequence == position + 1.
+        // All storage is allocated up front; push and pop never allocate.
+        class bounded_index_queue {
+        public:
+            // Room for twice max_items so a push only meets a cell still being
+            // read by a preempted consumer in pathological schedules
+            explicit bounded_index_queue(std::size_t max_items)
+                : capacity_(std::bit_ceil(std::max<std::size_t>(max_items * 2, 2))),
+                  mask_(capacity_ - 1),
+                  cells_(std::make_unique<cell[]>(capacity_)) {
+                for (std::size_t i = 0; i < capacity_; ++i) {
+                    cells_[i].sequence.store(i, std::memory_order_relaxed);
+                }
+            }
+
+            bounded_index_queue(const bounded_index_queue&) = delete;
+            bounded_index_queue& operator=(const bounded_index_queue&) = delete;
+
+            bool try_push(std::uint32_t value) noexcept {
+                std::size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+                while (true) {
+                    cell& c = cells_[pos & mask_];
+                    std::size_t seq = c.sequence.load(std::memory_order_acquire);
+                    auto diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos);
+                    if (diff == 0) {
+                        if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                            c.value = value;
+                            c.sequence.store(pos + 1, std::memory_order_release);
+                            return true;
+                        }
+                    } else if (diff < 0) {
+                        return false;  // Full
+                    } else {
+                        pos = enqueue_pos_.load(std::memory_order_relaxed);
+                    }
+                }
+            }
+
+            // Push when the caller knows at most max_items are queued; only
+            // spins while an earlier pop of the same cell completes
+            void push(std::uint32_t value) noexcept {
+                while (!try_push(value)) {
+                    std::this_thread::yield();
+                }
+            }
+
+            bool try_pop(std::uint32_t& value) noexcept {
+                std::size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+                while (true) {
+                    cell& c = cells_[pos & mask_];
+                    std::size_t seq = c.sequence.load(std::memory_order_acquire);
+                    auto diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos + 1);
+                    if (diff == 0) {
+                        if (dequeue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                            value = c.value;
+                            c.sequence.store(pos + capacity_, std::memory_order_release);
+                            return true;
+                        }
+                    } else if (diff < 0) {
+                        return false;  // Empty
+                    } else {
+                        pos = dequeue_pos_.load(std::memory_order_relaxed);
+                    }
+                }
+            }
+
+            // Number of queued items; exact only when no push or pop is in flight
+            [[nodiscard]] std::size_t size_approx() const noexcept {
+                std::size_t tail = enqueue_pos_.load(std::memory_order_relaxed);
+                std::size_t head = dequeue_pos_.load(std::memory_order_relaxed);
+                return tail > head ? tail - head : 0;
+            }
+
+        private:
+            struct cell {
+                std::atomic<std::size_t> sequence;
+                std::uint32_t value;
+            };
+
+            const std::size_t capacity_;
+            const std::size_t mask_;
+            std::unique_ptr<cell[]> cells_;
+            alignas(64) std::atomic<std::size_t> enqueue_pos_{0};
+            alignas(64) std::atomic<std::size_t> dequeue_pos_{0};
+        };
+
+        // Lock-free stack of slot indices (Treiber)
+        // Links live in a preallocated array indexed by slot; the head packs a
+        // modification tag with the top index so a pop cannot succeed on a head
+        // that was popped and pushed again meanwhile (ABA).
+        class index_stack {
+        public:
+            explicit index_stack(std::size_t max_items)
+                : next_(std::make_unique<std::atomic<std::uint32_t>[]>(max_items)) {}
+
+            index_stack(const index_stack&) = delete;
+            index_stack& operator=(const index_stack&) = delete;
+
+            // Each index may be on the stack at most once
+            void push(std::uint32_t value) noexcept {
+                std::uint64_t head = head_.load(std::memory_order_relaxed);
+                do {
+                    next_[value].store(top(head), std::memory_order_relaxed);
+                } while (!head_.compare_exchange_weak(head, pack(tag(head) + 1, value),
+                                                      std::memory_order_release, std::memory_order_relaxed));
+                size_.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            bool try_pop(std::uint32_t& value) noexcept {
+                std::uint64_t head = head_.load(std::memory_order_acquire);
+                while (top(head) != empty) {
+                    std::uint32_t next = next_[top(head)].load(std::memory_order_relaxed);
+                    if (head_.compare_exchange_weak(head, pack(tag(head) + 1, next),
+                                                    std::memory_order_acquire, std::memory_order_acquire)) {
+                        value = top(head);
+                        size_.fetch_sub(1, std::memory_order_relaxed);
+                        return true;
+                    }
+                }
+                return false;
+            }
+
+            // Number of stacked items; exact only when no push or pop is in flight
+            [[nodiscard]] std::size_t size_approx() const noexcept {
+                auto size = size_.load(std::memory_order_relaxed);
+                return size > 0 ? static_cast<std::size_t>(size) : 0;
+            }
+
+        private:
+            static constexpr std::uint32_t empty = UINT32_MAX;
+
+            static std::uint64_t pack(std::uint32_t tag, std::uint32_t top) noexcept {
+                return (static_cast<std::uint64_t>(tag) << 32) | top;
+            }
+            static std::uint32_t tag(std::uint64_t head) noexcept { return static_cast<std::uint32_t>(head >> 32); }
+            static std::uint32_t top(std::uint64_t head) noexcept { return static_cast<std::uint32_t>(head); }
+
+            std::unique_ptr<std::atomic<std::uint32_t>[]> next_;
+            alignas(64) std::atomic<std::uint64_t> head_{pack(0, empty)};
+            std::atomic<std::ptrdiff_t> size_{0};  // May dip below zero while a push is in flight
+        };
+
+        // Idle connections, ordered by the pool's reuse policy
+        class idle_list {
+        public:
+            idle_list(std::size_t max_items, reuse_policy policy)
+                : lifo_(policy != reuse_policy::fifo), queue_(lifo_ ? 1 : max_items), stack_(lifo_ ? max_items : 0) {}
+
+            void push(std::uint32_t value) noexcept {
+                if (lifo_) {
+                    stack_.push(value);
+                } else {
+                    queue_.push(value);
+                }
+            }
+
+            bool try_pop(std::uint32_t& value) noexcept {
+                return lifo_ ? stack_.try_pop(value) : queue_.try_pop(value);
+            }
+
+            // Put back indices popped in this order so they keep their positions
+            // relative to each other
+            void restore(const std::uint32_t* values, std::size_t count) noexcept {
+                for (std::size_t i = 0; i < count; ++i) {
+                    push(values[lifo_ ? count - 1 - i : i]);
+                }
+            }
+
+            [[nodiscard]] std::size_t size_approx() const noexcept {
+                return lifo_ ? stack_.size_approx() : queue_.size_approx();
+            }
+
+        private:
+            bool lifo_;
+            bounded_index_queue queue_;
+            index_stack stack_;
+        };
+
+        // One pool position. A slot is owned by whoever popped its index from
+        // one of the pool's queues (or holds the pooled_connection for it), so
+        // its fields need no synchronisation of their own.
+        struct connection_slot {
+            std::unique_ptr<database_connection> conn;
+            std::chrono::steady_clock::time_point created_at{};
+            std::chrono::steady_clock::time_point last_used{};   // When it was last made idle
+            std::chrono::steady_clock::time_point checked_out_at{};
+            database_connection::round_trip_stats round_trips_at_checkout{};
+            std::chrono::steady_clock::time_point retire_at = std::chrono::steady_clock::time_point::max();
+            std::uint32_t index = 0;
+        };
+
+        // Node of the pool's intrusive FIFO wait list
+        // Owned by the waiting caller; the pool only links and unlinks it, with
+        // its wait mutex held.
+        struct pool_waiter {
+            pool_waiter* prev = nullptr;
+            pool_waiter* next = nullptr;
+            bool queued = false;
+            bool granted = false;        // index/needs_connect hold the slot handed over
+            bool expired = false;        // Shed because its deadline passed
+            bool rejected = false;       // Shed because the circuit breaker opened
+            std::uint32_t index = 0;
+            bool needs_connect = false;
+            acquire_priority priority = acquire_priority::normal;
+            std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
+
+            // Called once with the wait mutex held, after the node was unlinked
+            // (granted == false means the waiter was shed or the pool is shutting down)
+            virtual void wake() noexcept = 0;
+
+        protected:
+            ~pool_waiter() = default;
+        };
+
+        class waiter_list {
+        public:
+            [[nodiscard]] bool empty() const noexcept { return head_ == nullptr; }
+
+            void push_back(pool_waiter& w) noexcept {
+                w.prev = tail_;
+                w.next = nullptr;
+                if (tail_) tail_->next = &w;
+                else head_ = &w;
+                tail_ = &w;
+                w.queued = true;
+            }
+
+            pool_waiter* pop_front() noexcept {
+                pool_waiter* w = head_;
+                if (w) remove(*w);
+                return w;
+            }
+
+            void remove(pool_waiter& w) noexcept {
+                if (w.prev) w.prev->next = w.next;
+                else head_ = w.next;
+                if (w.next) w.next->prev = w.prev;
+                else tail_ = w.prev;
+                w.prev = w.next = nullptr;
+                w.queued = false;
+            }
+
+            [[nodiscard]] pool_waiter* front() const noexcept { return head_; }
+
+        private:
+            pool_waiter* head_ = nullptr;
+            pool_waiter* tail_ = nullptr;
+        };
+
+        // Waiters of every priority class, FIFO within a class
+        // Hand-over is weighted round robin: per round, each class is served up
+        // to its weight, higher priorities first. Classes with weight 0 are only
+        // served when no weighted class is waiting, so weights {1, 0, 0} give
+        // strict priority.
+        class waiter_queue {
+        public:
+            static constexpr std::size_t classes = 3;
+
+            explicit waiter_queue(const std::array<unsigned, classes>& weights) noexcept
+                : weights_(weights), credits_(weights) {}
+
+            [[nodiscard]] bool empty() const noexcept {
+                return std::all_of(lists_.begin(), lists_.end(), [](const waiter_list& l) { return l.empty(); });
+            }
+
+            void push_back(pool_waiter& w) noexcept { list_of(w).push_back(w); }
+            void remove(pool_waiter& w) noexcept { list_of(w).remove(w); }
+
+            // Any waiter, for shutdown
+            pool_waiter* pop_front() noexcept {
+                for (auto& list : lists_) {
+                    if (auto* w = list.pop_front()) return w;
+                }
+                return nullptr;
+            }
+
+            // The waiter due next, left in the queue
+            [[nodiscard]] pool_waiter* next() noexcept {
+                for (int round = 0; round < 2; ++round) {
+                    for (std::size_t c = 0; c < classes; ++c) {
+                        if (!lists_[c].empty() && credits_[c] > 0) return lists_[c].front();
+                    }
+                    // Every waiting class used up its share: start a new round
+                    credits_ = weights_;
+                }
+                return first_waiting();
+            }
+
+            // Dequeue the waiter returned by next() and charge its class
+            void take(pool_waiter& w) noexcept {
+                remove(w);
+                auto& credit = credits_[static_cast<std::size_t>(w.priority)];
+                if (credit > 0) --credit;
+            }
+
+        private:
+            waiter_list& list_of(const pool_waiter& w) noexcept {
+                return lists_[static_cast<std::size_t>(w.priority)];
+            }
+
+            [[nodiscard]] pool_waiter* first_waiting() const noexcept {
+                for (const auto& list : lists_) {
+                    if (!list.empty()) return list.front();
+                }
+                return nullptr;
+            }
+
+            std::array<waiter_list, classes> lists_{};
+            std::array<unsigned, classes> weights_;
+            std::array<unsigned, classes> credits_;
+        };
+
+        // Waiter blocked in database_pool::acquire()
+        struct sync_pool_waiter final : pool_waiter {
+            std::condition_variable cv;
+            bool woken = false;
+
+            void wake() noexcept override {
+                woken = true;
+                cv.notify_one();
+            }
+        };
+
+        // Thread that runs task every interval until a stop is requested
+        template<typename Task>
+        std::jthread start_periodic(std::chrono::milliseconds interval, Task task) {
+            return std::jthread([interval, task = std::move(task)](std::stop_token stop) mutable {
+                std::mutex mutex;
+                std::condition_variable_any wake;
+                std::unique_lock<std::mutex> lock(mutex);
+                
+                // Sleeps for one interval; returns true once a stop is requested
+                while (!wake.wait_for(lock, stop, interval, [&stop] { return stop.stop_requested(); })) {
+                    lock.unlock();
+                    task();
+                    lock.lock();
+                }
+            });
+        }
+
+    } // namespace detail
+
     // RAII connection handle from pool with auto-reconnect capability
+    // Two pointers: the pool and the slot being borrowed. Acquiring one does
+    // not allocate.
     class pooled_connection {
     public:
         pooled_connection() = default;
-        
-        pooled_connection(std::unique_ptr<database_connection> conn,
-                         std::function<void(std::unique_ptr<database_connection>)> returner,
-                         std::function<std::unique_ptr<database_connection>()> reconnector = nullptr)
-            : conn_(std::move(conn)), returner_(std::move(returner)), reconnector_(std::move(reconnector)) {}
+
+        pooled_connection(database_pool* pool, detail::connection_slot* slot) noexcept
+            : pool_(pool), slot_(slot) {}
 
         ~pooled_connection() {
-            if (conn_ && returner_) {
-                returner_(std::move(conn_));
-            }
+            release();
         }
 
         // Disable copy, enable move
@@ -39,116 +422,124 @@ namespace fenrir {
         pooled_connection& operator=(const pooled_connection&) = delete;
         
         pooled_connection(pooled_connection&& other) noexcept
-            : conn_(std::move(other.conn_)), 
-              returner_(std::move(other.returner_)),
-              reconnector_(std::move(other.reconnector_)) {}
+            : pool_(std::exchange(other.pool_, nullptr)),
+              slot_(std::exchange(other.slot_, nullptr)) {}
         
         pooled_connection& operator=(pooled_connection&& other) noexcept {
             if (this != &other) {
-                if (conn_ && returner_) {
-                    returner_(std::move(conn_));
-                }
-                conn_ = std::move(other.conn_);
-                returner_ = std::move(other.returner_);
-                reconnector_ = std::move(other.reconnector_);
+                release();
+                pool_ = std::exchange(other.pool_, nullptr);
+                slot_ = std::exchange(other.slot_, nullptr);
             }
             return *this;
         }
 
-        database_connection* operator->() { return conn_.get(); }
-        const database_connection* operator->() const { return conn_.get(); }
-        database_connection& operator*() { return *conn_; }
-        const database_connection& operator*() const { return *conn_; }
+        database_connection* operator->() { return connection(); }
+        const database_connection* operator->() const { return connection(); }
+        database_connection& operator*() { return *connection(); }
+        const database_connection& operator*() const { return *connection(); }
 
         database_query get_query_builder() {
-            if (!conn_) {
+            if (!valid()) {
                 throw database_error{"No valid database connection"};
             }
-            return database_query(*conn_);
+            return database_query(*slot_->conn);
         }
 
-        [[nodiscard]] bool valid() const noexcept { return conn_ != nullptr; }
+        [[nodiscard]] bool valid() const noexcept { return slot_ && slot_->conn; }
         explicit operator bool() const noexcept { return valid(); }
 
         // Check if connection is healthy
         [[nodiscard]] bool is_healthy() const noexcept {
-            return conn_ && conn_->is_connected();
+            return valid() && slot_->conn->is_connected();
         }
 
         // Attempt to reconnect if connection is dead
-        bool try_reconnect() {
-            if (!reconnector_) return false;
-            
-            try {
-                // First try to reset existing connection
-                if (conn_) {
-                    try {
-                        conn_->reset();
-                        if (conn_->is_connected()) {
-                            return true;
-                        }
-                    } catch (...) {
-                        // Reset failed, will create new connection
+        bool try_reconnect();
+
+        // Coroutine counterpart of try_reconnect(): connects without blocking the executor
+        net::awaitable<bool> async_reconnect();
+
+        // Run func(connection), retrying transient failures as the policy allows
+        // Failures are classified by SQLSTATE (see classify_error). A dead
+        // connection is re-established before each attempt, and attempts are
+        // spaced by jittered exponential backoff within policy.deadline. Only
+        // operations marked idempotent are ever run a second time.
+        template<typename Func>
+        auto execute_with_retry(Func&& func, const retry_policy& policy) -> decltype(func(std::declval<database_connection&>())) {
+            detail::retry_schedule schedule(policy);
+            while (true) {
+                try {
+                    if (!is_healthy() && !try_reconnect()) {
+                        throw database_error{"Connection lost and reconnection failed"};
                     }
+                    return func(*slot_->conn);
+                } catch (const database_error& e) {
+                    auto reason = retry_reason_of(e);
+                    auto delay = schedule.next(reason);
+                    if (!delay) throw;
+                    count_retry();
+                    schedule.notify(e, reason, *delay);
+                    std::this_thread::sleep_for(*delay);
                 }
-                
-                // Create fresh connection
-                conn_ = reconnector_();
-                return conn_ && conn_->is_connected();
-            } catch (const std::exception& e) {
-                std::cerr << "Reconnection failed: " << e.what() << std::endl;
-                return false;
             }
         }
 
-        // Execute with automatic retry on connection error
+        // Retry after a lost connection up to max_retries times, whether or not
+        // func is idempotent (retry_policy::reconnect_only); the behavior from
+        // before retry policies existed
         template<typename Func>
         auto execute_with_retry(Func&& func, int max_retries = 2) -> decltype(func(std::declval<database_connection&>())) {
-            int attempts = 0;
+            return execute_with_retry(std::forward<Func>(func),
+                                      retry_policy::reconnect_only(static_cast<size_t>(std::max(max_retries, 0))));
+        }
+
+        // Coroutine counterpart of execute_with_retry(): func(connection) returns
+        // an awaitable, and backoff waits on a timer instead of the thread
+        template<typename Func>
+        auto async_execute_with_retry(Func func, retry_policy policy = {})
+            -> decltype(func(std::declval<database_connection&>())) {
+            detail::retry_schedule schedule(policy);
             while (true) {
+                std::optional<std::chrono::milliseconds> delay;
                 try {
-                    if (!is_healthy()) {
-                        if (!try_reconnect()) {
-                            throw database_error{"Connection lost and reconnection failed"};
-                        }
+                    if (!is_healthy() && !co_await async_reconnect()) {
+                        throw database_error{"Connection lost and reconnection failed"};
                     }
-                    return func(*conn_);
+                    co_return co_await func(*slot_->conn);
                 } catch (const database_error& e) {
-                    ++attempts;
-                    std::string error_msg = e.what();
-                    
-                    // Check if this is a recoverable connection error
-                    bool is_connection_error = 
-                        error_msg.find("connection") != std::string::npos ||
-                        error_msg.find("server closed") != std::string::npos ||
-                        error_msg.find("no connection") != std::string::npos ||
-                        error_msg.find("timeout") != std::string::npos ||
-                        !is_healthy();
-                    
-                    if (is_connection_error && attempts <= max_retries) {
-                        std::cerr << "Connection error (attempt " << attempts 
-                                  << "/" << max_retries << "): " << error_msg 
-                                  << ". Retrying..." << std::endl;
-                        
-                        if (!try_reconnect()) {
-                            throw database_error{
-                                std::format("Failed to reconnect after {} attempts: {}", 
-                                           attempts, error_msg)};
-                        }
-                        continue;  // Retry the operation
-                    }
-                    throw;  // Non-recoverable error or max retries exceeded
+                    auto reason = retry_reason_of(e);
+                    delay = schedule.next(reason);
+                    if (!delay) throw;
+                    count_retry();
+                    schedule.notify(e, reason, *delay);
                 }
+                net::steady_timer timer(co_await net::this_coro::executor, *delay);
+                co_await timer.async_wait(net::use_awaitable);
             }
         }
 
     private:
-        std::unique_ptr<database_connection> conn_;
-        std::function<void(std::unique_ptr<database_connection>)> returner_;
-        std::function<std::unique_ptr<database_connection>()> reconnector_;
+        [[nodiscard]] database_connection* connection() const noexcept {
+            return slot_ ? slot_->conn.get() : nullptr;
+        }
+
+        // Hand the slot back to the pool (defined after database_pool)
+        void release() noexcept;
+
+        // classify_error(), except that nothing is retried into an open circuit breaker
+        [[nodiscard]] retry_reason retry_reason_of(const database_error& error) const noexcept;
+        void count_retry() noexcept;
+
+        database_pool* pool_ = nullptr;
+        detail::connection_slot* slot_ = nullptr;
     };
 
     // Thread-safe connection pool
+    // Idle connections and unused slots live in two lock-free index queues, so
+    // acquire and release are a CAS each when a connection is available. Callers
+    // that have to wait (blocking or coroutine) queue up in FIFO order behind a
+    // mutex, and returned slots are handed to them directly.
     class database_pool {
     public:
         struct pool_config {
@@ -157,7 +548,19 @@ namespace fenrir {
             size_t min_connections = 2;
             size_t max_connections = 10;
             std::chrono::seconds connection_timeout{30};
-            std::chrono::seconds idle_timeout{300};
+            std::chrono::seconds idle_timeout{300};         // Idle connections above min_connections are closed after this
+            std::chrono::seconds max_lifetime{0};           // Retire connections this old (0 = never); jittered by up to 1/8
+            std::chrono::seconds maintenance_interval{30};  // Background maintain() period (0 = no maintenance thread)
+            std::array<unsigned, 3> priority_weights{8, 4, 1};  // Hand-over share of interactive, normal, batch waiters
+            reuse_policy reuse = reuse_policy::fifo;        // Which idle connection acquire() hands out
+            size_t affinity_scan = 4;                       // Idle connections acquire_for() inspects (statement_affinity)
+            concurrency_limit_config adaptive_limit;        // Connections in use at once, adjusted to measured round trips
+            circuit_breaker_config circuit_breaker;         // Fail acquires fast while the server keeps failing
+            std::vector<std::string> session_setup;         // Run on every new connection, e.g. "SET search_path TO app"
+            std::vector<std::pair<std::string, std::string>> prepared_statements;  // Name and SQL prepared on every new connection
+            std::function<void(database_connection&)> on_connect;  // After session setup, before first use
+            std::function<bool(database_connection&)> on_return;   // Before reuse; false closes the connection
+            std::function<void(const pool_metrics&)> on_metrics;  // Called after each background maintain()
             bool validate_on_acquire = true;
             bool use_connection_string = true;
             boost::asio::io_context* io_context = nullptr;  // Optional for async support
@@ -165,22 +568,42 @@ namespace fenrir {
 
         explicit database_pool(const pool_config& config)
             : config_(config),
-              active_connections_(0),
-              shutdown_(false) {
+              conninfo_(config.use_connection_string
+                            ? config.connection_string
+                            : database_connection::to_conninfo(config.connection_params)),
+              slots_(std::make_unique<detail::connection_slot[]>(config.max_connections)),
+              idle_(config.max_connections, config.reuse),
+              empty_(config.max_connections),
+              waiting_(config.priority_weights),
+              limiter_(config.adaptive_limit.enabled
+                           ? std::make_unique<detail::gradient_limiter>(config.adaptive_limit, config.max_connections)
+                           : nullptr),
+              breaker_(config.circuit_breaker.enabled
+                           ? std::make_unique<detail::circuit_breaker>(config.circuit_breaker)
+                           : nullptr) {
             
             if (config_.min_connections > config_.max_connections) {
                 throw database_error{"min_connections cannot exceed max_connections"};
             }
 
-            // Create minimum connections
-            for (size_t i = 0; i < config_.min_connections; ++i) {
-                try {
-                    available_connections_.push(create_connection());
-                } catch (const database_error& e) {
-                    // Clean up and rethrow
-                    shutdown();
-                    throw;
-                }
+            for (size_t i = 0; i < config_.max_connections; ++i) {
+                slots_[i].index = static_cast<std::uint32_t>(i);
+                empty_.push(static_cast<std::uint32_t>(i));
+            }
+
+            // Create minimum connections (concurrently)
+            std::string error;
+            if (connect_empty_slots(config_.min_connections, &error) < config_.min_connections) {
+                // Clean up and rethrow
+                shutdown();
+                throw database_error{error};
+            }
+
+            if (config_.maintenance_interval.count() > 0) {
+                maintenance_thread_ = detail::start_periodic(config_.maintenance_interval, [this] {
+                    maintain();
+                    if (config_.on_metrics) config_.on_metrics(get_metrics());
+                });
             }
         }
 
@@ -195,75 +618,74 @@ namespace fenrir {
         database_pool& operator=(database_pool&&) = delete;
 
         // Acquire connection from pool
+        // Callers that have to wait are served by priority class (see
+        // pool_config::priority_weights), in arrival order within a class
         [[nodiscard]] pooled_connection acquire(
-            std::chrono::milliseconds timeout = std::chrono::milliseconds(5000)) {
+            std::chrono::milliseconds timeout = std::chrono::milliseconds(5000),
+            acquire_priority priority = acquire_priority::normal) {
             
-            using namespace std::chrono;
-            auto deadline = steady_clock::now() + timeout;
-
-            std::unique_lock<std::mutex> lock(mutex_);
-
-            while (true) {
-                if (shutdown_) {
-                    throw database_error{"Pool is shutting down"};
-                }
-
-                // Try to get available connection
-                if (!available_connections_.empty()) {
-                    auto conn = std::move(available_connections_.front());
-                    available_connections_.pop();
-                    
-                    // Validate connection if configured
-                    if (config_.validate_on_acquire && !conn->is_connected()) {
-                        try {
-                            conn->reset();
-                        } catch (...) {
-                            // Create new connection if reset fails
-                            conn = create_connection();
-                        }
-                    }
-
-                    ++active_connections_;
-                    
-                    // Return with custom deleter that returns to pool and reconnector for auto-recovery
-                    return pooled_connection(
-                        std::move(conn),
-                        [this](std::unique_ptr<database_connection> c) {
-                            this->return_connection(std::move(c));
-                        },
-                        [this]() {
-                            return this->create_connection();
-                        }
-                    );
-                }
+            if (shutdown_.load(std::memory_order_acquire)) {
+                throw database_error{"Pool is shutting down"};
+            }
+            reject_if_open();
+            return acquire_allowed(timeout, priority);
+        }
 
-                // Try to create new connection if under max limit
-                size_t total = active_connections_ + available_connections_.size();
-                if (total < config_.max_connections) {
-                    auto conn = create_connection();
-                    ++active_connections_;
-                    
-                    return pooled_connection(
-                        std::move(conn),
-                        [this](std::unique_ptr<database_connection> c) {
-                            this->return_connection(std::move(c));
-                        },
-                        [this]() {
-                            return this->create_connection();
-                        }
-                    );
-                }
+        // Acquire only if it needs no waiting: an idle connection, or (when
+        // open_new is set) a new connection in an unused slot
+        [[nodiscard]] std::optional<pooled_connection> try_acquire(bool open_new = true) {
+            if (shutdown_.load(std::memory_order_acquire)) {
+                throw database_error{"Pool is shutting down"};
+            }
+            reject_if_open();
+            if (callers_queued()) return std::nullopt;
+            
+            std::uint32_t index;
+            if (idle_.try_pop(index)) {
+                if (!admit(index, false)) return std::nullopt;
+                telemetry_.acquire_wait.record_us(0);
+                return checkout(index, false);
+            }
+            if (open_new && try_take_empty(index)) {
+                if (!admit(index, true)) return std::nullopt;
+                telemetry_.acquire_wait.record_us(0);
+                return checkout(index, true);
+            }
+            return std::nullopt;
+        }
 
-                // Wait for connection to become available
-                auto now = steady_clock::now();
-                if (now >= deadline) {
-                    throw database_error{"Timeout waiting for connection"};
+        // Acquire a connection that will run the named prepared statement
+        // With reuse_policy::statement_affinity, the most recently used idle
+        // connections are inspected and one that already prepared the statement
+        // is preferred, saving a Parse round trip. Otherwise same as acquire().
+        [[nodiscard]] pooled_connection acquire_for(
+            std::string_view statement,
+            std::chrono::milliseconds timeout = std::chrono::milliseconds(5000),
+            acquire_priority priority = acquire_priority::normal) {
+            
+            if (shutdown_.load(std::memory_order_acquire)) {
+                throw database_error{"Pool is shutting down"};
+            }
+            reject_if_open();
+            
+            if (config_.reuse == reuse_policy::statement_affinity && !callers_queued()) {
+                std::uint32_t index;
+                if (try_take_prepared(statement, index) && admit(index, false)) {
+                    telemetry_.acquire_wait.record_us(0);
+                    return checkout(index, false);
                 }
-
-                cv_.wait_until(lock, deadline);
             }
+            return acquire_allowed(timeout, priority);
         }
 
+        // Acquire without blocking the calling thread
+        // Waiting coroutines queue in the same FIFO as blocking callers and are
+        // resumed on their own executor. Cancelling the awaiting operation (Boost
+        // 1.77+ cancellation slots) removes it from the queue.
+        [[nodiscard]] net::awaitable<pooled_connection> async_acquire(
+            std::chrono::milliseconds timeout = std::chrono::milliseconds(5000),
+            acquire_priority priority = acquire_priority::normal);
+
         // Get pool statistics
         struct pool_stats {
             size_t active_connections;
@@ -272,139 +694,928 @@ namespace fenrir {
             size_t max_connections;
         };
 
+        // Lock-free snapshot; may be mid-update under concurrent use
         [[nodiscard]] pool_stats get_stats() const {
-            std::lock_guard<std::mutex> lock(mutex_);
+            size_t total = connections_.load(std::memory_order_relaxed);
+            size_t available = std::min(idle_.size_approx(), total);
             return pool_stats{
-                .active_connections = active_connections_,
-                .available_connections = available_connections_.size(),
-                .total_connections = active_connections_ + available_connections_.size(),
+                .active_connections = total - available,
+                .available_connections = available,
+                .total_connections = total,
                 .max_connections = config_.max_connections
             };
         }
 
+        // Counters, latency histograms and current gauges, read without locking
+        // Like get_stats(), a snapshot taken under concurrent use may be
+        // mid-update. Use pool_metrics::to_prometheus() to export it.
+        [[nodiscard]] pool_metrics get_metrics() const {
+            auto stats = get_stats();
+            pool_metrics metrics;
+            metrics.active_connections = stats.active_connections;
+            metrics.available_connections = stats.available_connections;
+            metrics.total_connections = stats.total_connections;
+            metrics.max_connections = stats.max_connections;
+            metrics.waiting = waiters_.load(std::memory_order_relaxed);
+            metrics.concurrency_limit = limiter_ ? limiter_->limit() : config_.max_connections;
+            metrics.open_circuits = breaker_ && breaker_->state() != circuit_state::closed ? 1 : 0;
+            telemetry_.copy_to(metrics);
+            return metrics;
+        }
+
         // Drain pool and close all connections
+        // Connections still checked out are closed when they are returned;
+        // waiting callers fail with "Pool is shutting down".
         void shutdown() {
-            std::lock_guard<std::mutex> lock(mutex_);
-            shutdown_ = true;
+            shutdown_.store(true, std::memory_order_seq_cst);
             
-            // Clear all available connections
-            while (!available_connections_.empty()) {
-                available_connections_.pop();
+            if (maintenance_thread_.joinable()) {
+                maintenance_thread_.request_stop();
+                maintenance_thread_.join();
             }
+            drain_idle();
             
-            cv_.notify_all();
+            std::lock_guard<std::mutex> lock(wait_mutex_);
+            while (auto* waiter = waiting_.pop_front()) {
+                waiters_.fetch_sub(1, std::memory_order_relaxed);
+                waiter->wake();
+            }
         }
 
         [[nodiscard]] bool is_shutdown() const {
-            std::lock_guard<std::mutex> lock(mutex_);
-            return shutdown_;
+            return shutdown_.load(std::memory_order_acquire);
         }
 
         // Perform health check and cleanup of stale connections
-        // Returns number of connections removed/replaced
+        // Closes idle connections that are dead, past their max_lifetime, or
+        // (while above min_connections) idle longer than idle_timeout, then
+        // tops the pool back up to min_connections. Runs every
+        // maintenance_interval on the pool's own thread; may also be called
+        // directly. Returns number of connections removed/replaced
         size_t maintain() {
-            std::lock_guard<std::mutex> lock(mutex_);
+            if (is_shutdown()) return 0;
             
-            if (shutdown_) return 0;
+            auto now = std::chrono::steady_clock::now();
+            size_t live = connections_.load(std::memory_order_relaxed);
             
-            size_t removed = 0;
-            std::queue<std::unique_ptr<database_connection>> healthy_connections;
-            
-            // Check all available connections
-            while (!available_connections_.empty()) {
-                auto conn = std::move(available_connections_.front());
-                available_connections_.pop();
+            // Check each connection that is idle right now, then put the healthy
+            // ones back in their original order. While they are out, acquirers
+            // queue for them instead of opening connections in empty slots, and
+            // the rejected ones are only closed once the others are back.
+            std::vector<std::uint32_t> keep;
+            std::vector<std::uint32_t> drop;
+            keep.reserve(idle_.size_approx());
+            held_for_maintenance_.fetch_add(1, std::memory_order_seq_cst);
+            std::uint32_t index;
+            while (idle_.try_pop(index)) {
+                auto& slot = slots_[index];
+                
+                bool idle_expired = config_.idle_timeout.count() > 0 &&
+                                    now - slot.last_used > config_.idle_timeout &&
+                                    live > config_.min_connections;
                 
-                if (conn && conn->is_connected()) {
-                    healthy_connections.push(std::move(conn));
+                if (slot.conn && slot.conn->is_connected() && now < slot.retire_at && !idle_expired) {
+                    keep.push_back(index);
                 } else {
-                    ++removed;
+                    drop.push_back(index);
+                    if (slot.conn) --live;
                 }
             }
+            held_for_maintenance_.fetch_sub(1, std::memory_order_seq_cst);
+            idle_.restore(keep.data(), keep.size());
+            notify_waiter();  // Also when nothing came back: waiters may have queued for empty slots
             
-            available_connections_ = std::move(healthy_connections);
-            
-            // Replenish pool to minimum connections
-            size_t total = active_connections_ + available_connections_.size();
-            while (total < config_.min_connections) {
-                try {
-                    available_connections_.push(create_connection());
-                    ++total;
-                } catch (const database_error& e) {
-                    std::cerr << "Failed to replenish pool: " << e.what() << std::endl;
-                    break;
-                }
+            for (auto dropped : drop) {
+                discard(dropped);
             }
             
-            return removed;
+            replenish();
+            return drop.size();
         }
 
         // Force refresh all available connections
         void refresh_all() {
-            std::lock_guard<std::mutex> lock(mutex_);
+            if (is_shutdown()) return;
             
-            if (shutdown_) return;
+            drain_idle();
             
-            // Clear all available connections
-            while (!available_connections_.empty()) {
-                available_connections_.pop();
+            // Create fresh connections up to min_connections
+            std::string error;
+            connect_empty_slots(config_.min_connections, &error);
+            if (!error.empty()) {
+                std::cerr << "Failed to refresh connection: " << error << std::endl;
+            }
+        }
+
+    private:
+        friend class pooled_connection;
+
+        // acquire() once the caller is past the circuit breaker
+        pooled_connection acquire_allowed(std::chrono::milliseconds timeout, acquire_priority priority) {
+            using namespace std::chrono;
+
+            // Fast path: no lock
+            std::uint32_t index;
+            bool needs_connect = false;
+            if (try_take_unqueued(index, needs_connect)) {
+                telemetry_.acquire_wait.record_us(0);
+                return checkout(index, needs_connect);
+            }
+            reject_if_limited();
+
+            // Slow path: queue up and block until a slot is handed over
+            auto start = steady_clock::now();
+            auto deadline = start + timeout;
+            std::unique_lock<std::mutex> lock(wait_mutex_);
+            switch (register_waiter(index, needs_connect)) {
+                case wait_registration::taken:
+                    lock.unlock();
+                    telemetry_.acquire_wait.record(steady_clock::now() - start);
+                    return checkout(index, needs_connect);
+                case wait_registration::shutting_down:
+                    throw database_error{"Pool is shutting down"};
+                case wait_registration::queue:
+                    break;
             }
             
-            // Create fresh connections up to min_connections
-            for (size_t i = 0; i < config_.min_connections; ++i) {
-                try {
-                    available_connections_.push(create_connection());
-                } catch (const database_error& e) {
-                    std::cerr << "Failed to refresh connection: " << e.what() << std::endl;
+            detail::sync_pool_waiter waiter;
+            waiter.priority = priority;
+            waiter.deadline = deadline;
+            waiting_.push_back(waiter);
+            while (!waiter.woken) {
+                if (waiter.cv.wait_until(lock, deadline) == std::cv_status::timeout && !waiter.woken) {
+                    waiting_.remove(waiter);
+                    waiters_.fetch_sub(1, std::memory_order_relaxed);
+                    telemetry_.bump(telemetry_.timeouts);
+                    throw pool_busy_error{"Timeout waiting for connection"};
                 }
             }
+            lock.unlock();
             
-            cv_.notify_all();
+            if (waiter.rejected) {
+                telemetry_.bump(telemetry_.breaker_rejections);
+                throw database_error{"Circuit breaker open"};
+            } else if (waiter.expired) {
+                telemetry_.bump(telemetry_.timeouts);
+                throw pool_busy_error{"Timeout waiting for connection"};
+            } else if (!waiter.granted) {
+                throw database_error{"Pool is shutting down"};
+            }
+            telemetry_.acquire_wait.record(steady_clock::now() - start);
+            return checkout(waiter.index, waiter.needs_connect);
+        }
+
+        // Waiter suspended in async_acquire()
+        // Timer expiry, cancellation and hand-over all run on a strand of the
+        // handler's executor; the wait mutex decides which of them wins.
+        template<typename Handler>
+        class async_waiter final
+            : public detail::pool_waiter,
+              public std::enable_shared_from_this<async_waiter<Handler>> {
+        public:
+            async_waiter(database_pool& pool, Handler handler)
+                : pool_(pool),
+                  handler_(std::move(handler)),
+                  strand_(net::make_strand(net::get_associated_executor(handler_))),
+                  timer_(strand_) {}
+
+            ~async_waiter() {
+                // The completion was dropped (e.g. io_context destroyed): give the slot back
+                if (granted && !completed_) {
+                    pool_.release_slot(index, !needs_connect);
+                }
+            }
+
+            // Called with the wait mutex held, right after the node was queued
+            void start(std::chrono::steady_clock::time_point deadline) {
+                timer_.expires_at(deadline);
+                timer_.async_wait([self = this->shared_from_this()](boost::system::error_code ec) {
+                    if (ec != net::error::operation_aborted) {
+                        self->abandon(net::error::timed_out);
+                    }
+                });
+#if BOOST_VERSION >= 107700
+                auto slot = net::get_associated_cancellation_slot(handler_);
+                if (slot.is_connected()) {
+                    slot.assign([weak = this->weak_from_this()](net::cancellation_type) {
+                        if (auto self = weak.lock()) {
+                            net::post(self->strand_, [self] {
+                                self->abandon(net::error::operation_aborted);
+                            });
+                        }
+                    });
+                }
+#endif
+            }
+
+            void wake() noexcept override {
+                net::post(strand_, [self = this->shared_from_this()] {
+                    self->timer_.cancel();
+                    self->complete(self->granted    ? boost::system::error_code{}
+                                   : self->rejected ? boost::system::error_code{net::error::connection_refused}
+                                   : self->expired  ? boost::system::error_code{net::error::timed_out}
+                                                    : boost::system::error_code{net::error::shut_down});
+                });
+            }
+
+        private:
+            // Timed out or cancelled: leave the queue unless a slot arrived first
+            void abandon(boost::system::error_code ec) {
+                {
+                    std::lock_guard<std::mutex> lock(pool_.wait_mutex_);
+                    if (!queued) return;  // wake() already posted the completion
+                    pool_.waiting_.remove(*this);
+                    pool_.waiters_.fetch_sub(1, std::memory_order_relaxed);
+                }
+                complete(ec);
+            }
+
+            void complete(boost::system::error_code ec) {
+#if BOOST_VERSION >= 107700
+                net::get_associated_cancellation_slot(handler_).clear();
+#endif
+                auto executor = net::get_associated_executor(handler_);
+                net::dispatch(executor, [self = this->shared_from_this(), ec]() {
+                    self->completed_ = true;
+                    std::move(self->handler_)(ec, self->index, self->needs_connect);
+                });
+            }
+
+            database_pool& pool_;
+            Handler handler_;
+            net::strand<net::associated_executor_t<Handler>> strand_;
+            net::steady_timer timer_;
+            bool completed_ = false;
+        };
+
+        // Queue a waiter for the next free slot; completes with (ec, index, needs_connect)
+        template<typename CompletionToken>
+        auto async_wait_for_slot(std::chrono::steady_clock::time_point deadline, acquire_priority priority,
+                                 CompletionToken&& token) {
+            return net::async_initiate<CompletionToken, void(boost::system::error_code, std::uint32_t, bool)>(
+                [this, deadline, priority](auto handler) {
+                    using waiter_type = async_waiter<std::decay_t<decltype(handler)>>;
+                    auto waiter = std::make_shared<waiter_type>(*this, std::move(handler));
+                    waiter->priority = priority;
+                    waiter->deadline = deadline;
+                    
+                    std::lock_guard<std::mutex> lock(wait_mutex_);
+                    switch (register_waiter(waiter->index, waiter->needs_connect)) {
+                        case wait_registration::taken:
+                            waiter->granted = true;
+                            waiter->wake();  // Posts; never completes inside the initiation
+                            break;
+                        case wait_registration::shutting_down:
+                            waiter->wake();
+                            break;
+                        case wait_registration::queue:
+                            waiting_.push_back(*waiter);
+                            waiter->start(deadline);
+                            break;
+                    }
+                },
+                token);
+        }
+
+        enum class wait_registration { taken, queue, shutting_down };
+
+        // With wait_mutex_ held: count the caller as a waiter, then re-check for a
+        // slot. Either this re-check or the releaser's waiter check (after its
+        // push) sees the other side. On `queue` the caller must link itself into
+        // waiting_ before releasing the mutex.
+        wait_registration register_waiter(std::uint32_t& index, bool& needs_connect) noexcept {
+            waiters_.fetch_add(1, std::memory_order_seq_cst);
+            if (shutdown_.load(std::memory_order_acquire)) {
+                waiters_.fetch_sub(1, std::memory_order_relaxed);
+                return wait_registration::shutting_down;
+            }
+            // Behind callers already queued: notify_waiter() will run for the
+            // slot that made this re-check succeed, and serves by priority
+            if (waiting_.empty() && try_take(index, needs_connect)) {
+                waiters_.fetch_sub(1, std::memory_order_relaxed);
+                return wait_registration::taken;
+            }
+            return wait_registration::queue;
         }
 
-    private:
         std::unique_ptr<database_connection> create_connection() {
+            auto start = std::chrono::steady_clock::now();
+            try {
+                auto conn = std::make_unique<database_connection>(conninfo_);
+                warm_up(*conn);
+                connected(start);
+                return conn;
+            } catch (...) {
+                connect_failed(start);
+                throw;
+            }
+        }
+
+        // Coroutine counterpart of create_connection()
+        net::awaitable<std::unique_ptr<database_connection>> async_create_connection() {
+            auto start = std::chrono::steady_clock::now();
             std::unique_ptr<database_connection> conn;
-            
-            if (config_.use_connection_string) {
-                conn = std::make_unique<database_connection>(config_.connection_string);
+            try {
+                conn = std::make_unique<database_connection>(
+                    co_await database_connection::async_connect(conninfo_, config_.connection_timeout));
+                co_await async_warm_up(*conn);
+            } catch (...) {
+                connect_failed(start);
+                throw;
+            }
+            connected(start);
+            co_return conn;
+        }
+
+        // Bring a new (or reset) connection into the state every borrower
+        // expects: session setup and statement preparation go out as one
+        // pipeline, so they cost a single round trip. Then on_connect runs.
+        void warm_up(database_connection& conn) {
+            if (needs_warm_up()) {
+                database_pipeline pipeline(conn);
+                queue_warm_up(pipeline);
+                (void)pipeline.sync();
+            }
+            if (config_.on_connect) config_.on_connect(conn);
+        }
+
+        net::awaitable<void> async_warm_up(database_connection& conn) {
+            if (needs_warm_up()) {
+                database_pipeline pipeline(conn);
+                queue_warm_up(pipeline);
+                (void)co_await pipeline.async_sync();
+            }
+            if (config_.on_connect) config_.on_connect(conn);
+        }
+
+        bool needs_warm_up() const noexcept {
+            return !config_.session_setup.empty() || !config_.prepared_statements.empty();
+        }
+
+        void queue_warm_up(database_pipeline& pipeline) const {
+            for (const auto& sql : config_.session_setup) {
+                pipeline.send(sql);
+            }
+            for (const auto& [name, sql] : config_.prepared_statements) {
+                pipeline.send_prepare(name, sql);
+            }
+        }
+
+        // Undo what the last borrower left behind, only where there is
+        // something to undo: an open transaction is rolled back (its SET LOCALs
+        // go with it), a connection still busy with a query is not reused.
+        // Then on_return decides. The state check needs no round trip.
+        bool prepare_for_reuse(database_connection& conn) noexcept {
+            try {
+                switch (conn.transaction_status()) {
+                    case PQTRANS_IDLE:
+                        break;
+                    case PQTRANS_INTRANS:
+                    case PQTRANS_INERROR:
+                        PQclear(conn.execute("ROLLBACK"));
+                        break;
+                    default:
+                        return false;
+                }
+                return !config_.on_return || config_.on_return(conn);
+            } catch (...) {
+                return false;
+            }
+        }
+
+        void connected(std::chrono::steady_clock::time_point start) noexcept {
+            telemetry_.connect_latency.record(std::chrono::steady_clock::now() - start);
+            telemetry_.bump(telemetry_.connects);
+            record_outcome(true);
+        }
+
+        void connect_failed(std::chrono::steady_clock::time_point start) noexcept {
+            telemetry_.connect_latency.record(std::chrono::steady_clock::now() - start);
+            telemetry_.bump(telemetry_.connect_failures);
+            record_outcome(false);
+        }
+
+        // Feed a connect, validation or reconnect outcome to the circuit breaker
+        // Returned connections report nothing: a return says neither that a
+        // query ran nor that it succeeded.
+        // Queued waiters are failed as soon as it opens.
+        void record_outcome(bool ok) noexcept {
+            if (!breaker_) return;
+            auto now = std::chrono::steady_clock::now();
+            if (ok) {
+                breaker_->record_success(now);
+            } else if (breaker_->record_failure(now)) {
+                notify_waiter();
+            }
+        }
+
+        [[nodiscard]] bool circuit_open() const noexcept {
+            return breaker_ && breaker_->state() == circuit_state::open;
+        }
+
+        [[nodiscard]] bool breaker_allows() noexcept {
+            return !breaker_ || breaker_->allow();
+        }
+
+        // While the circuit breaker is open, fail at once instead of queuing
+        // behind a dead server or connecting to it
+        void reject_if_open() {
+            if (!breaker_allows()) {
+                telemetry_.bump(telemetry_.breaker_rejections);
+                throw database_error{"Circuit breaker open"};
+            }
+        }
+
+        // Claim an idle connection, or failing that an empty slot to connect
+        // Also takes a place under the adaptive limit; the claim fails while
+        // the limit is reached even if connections are idle.
+        bool try_take(std::uint32_t& index, bool& needs_connect) noexcept {
+            if (limiter_ && limiter_->at_limit()) {
+                return false;
+            }
+            if (idle_.try_pop(index)) {
+                needs_connect = false;
+            } else if (try_take_empty(index)) {
+                needs_connect = true;
+            } else {
+                return false;
+            }
+            return admit(index, needs_connect);
+        }
+
+        // Claim a slot without a connection, unless maintain() has the idle
+        // connections out for checking: they are about to come back, and
+        // put_back() hands them to whoever queued meanwhile
+        bool try_take_empty(std::uint32_t& index) noexcept {
+            return held_for_maintenance_.load(std::memory_order_seq_cst) == 0 && empty_.try_pop(index);
+        }
+
+        // try_take() for a caller that has not queued; fails while others are
+        // queued or registering, so a slot freed meanwhile goes to them by
+        // priority rather than to whoever asks first
+        bool try_take_unqueued(std::uint32_t& index, bool& needs_connect) noexcept {
+            return !callers_queued() && try_take(index, needs_connect);
+        }
+
+        [[nodiscard]] bool callers_queued() const noexcept {
+            return waiters_.load(std::memory_order_seq_cst) != 0;
+        }
+
+        // Take a place under the adaptive limit for a claimed slot (always
+        // succeeds without one). At the limit the slot goes back without waking
+        // anyone: the claims holding the places wake waiters as they return.
+        bool admit(std::uint32_t index, bool needs_connect) noexcept {
+            if (!limiter_ || limiter_->try_acquire()) {
+                return true;
+            }
+            if (needs_connect) {
+                empty_.push(index);
             } else {
-                conn = std::make_unique<database_connection>(config_.connection_params);
+                idle_.restore(&index, 1);
             }
+            return false;
+        }
+
+        // Give back the place of a claim that handed out no connection
+        void leave() noexcept {
+            if (limiter_) limiter_->release();
+        }
+
+        // With adaptive_limit.reject set, fail instead of queuing behind the limit
+        void reject_if_limited() {
+            if (limiter_ && config_.adaptive_limit.reject && limiter_->at_limit()) {
+                telemetry_.bump(telemetry_.rejections);
+                throw pool_busy_error{"Concurrency limit reached"};
+            }
+        }
+
+        // Claim an idle connection that has the statement prepared, or else the
+        // most recently used one among the first affinity_scan
+        bool try_take_prepared(std::string_view statement, std::uint32_t& index) {
+            constexpr size_t max_scan = 16;
+            std::uint32_t popped[max_scan];
+            size_t limit = std::clamp<size_t>(config_.affinity_scan, 1, max_scan);
+            
+            size_t count = 0;
+            while (count < limit && idle_.try_pop(popped[count])) {
+                if (slots_[popped[count]].conn->is_prepared(statement)) {
+                    index = popped[count];
+                    put_back(popped, count);
+                    return true;
+                }
+                ++count;
+            }
+            if (count == 0) return false;
             
+            index = popped[0];
+            put_back(popped + 1, count - 1);
+            return true;
+        }
+
+        // Return idle slots inspected but not taken, keeping their order
+        void put_back(const std::uint32_t* indices, size_t count) noexcept {
+            if (count == 0) return;
+            idle_.restore(indices, count);
+            notify_waiter();
+        }
+
+        // Discards the slot on scope exit unless dismissed
+        struct slot_guard {
+            database_pool* pool;
+            std::uint32_t index;
+            bool admitted = false;  // Also give back the claim's place under the limit
+            ~slot_guard() {
+                if (!pool) return;
+                if (admitted) pool->leave();
+                pool->discard(index);
+            }
+        };
+
+        // Coroutine counterpart of checkout(): connects without blocking the
+        // executor, and replaces a dead connection rather than resetting it
+        net::awaitable<pooled_connection> async_checkout(std::uint32_t index, bool needs_connect) {
+            auto& slot = slots_[index];
+            slot_guard guard{this, index, true};  // Also covers the frame being destroyed mid-connect
+            
+            if (!needs_connect && !validate(slot)) {
+                telemetry_.bump(telemetry_.reconnects);
+                needs_connect = true;
+            }
+            if (needs_connect) {
+                install(slot, co_await async_create_connection());
+            }
+            
+            guard.pool = nullptr;
+            co_return hand_out(slot);
+        }
+
+        // Turn a claimed slot into a handle; connects or revalidates outside any lock
+        pooled_connection checkout(std::uint32_t index, bool needs_connect) {
+            auto& slot = slots_[index];
+            try {
+                if (needs_connect) {
+                    connect_slot(slot);
+                } else if (!validate(slot)) {
+                    telemetry_.bump(telemetry_.reconnects);
+                    try {
+                        slot.conn->reset();
+                        warm_up(*slot.conn);  // The reset session lost its setup
+                    } catch (...) {
+                        // Create new connection if reset fails
+                        connect_slot(slot);
+                    }
+                }
+            } catch (...) {
+                leave();
+                discard(index);
+                throw;
+            }
+            
+            return hand_out(slot);
+        }
+
+        // validate_on_acquire check of an idle connection; true if usable
+        // While the circuit breaker is not closed the acquire is a probe, so
+        // the connection is checked with a round trip to the server whether
+        // or not validate_on_acquire is set.
+        bool validate(detail::connection_slot& slot) noexcept {
+            bool probing = breaker_ && breaker_->state() != circuit_state::closed;
+            if (!config_.validate_on_acquire && !probing) return true;
+            telemetry_.bump(telemetry_.validations);
+            if (slot.conn->is_connected() && (!probing || server_responds(*slot.conn))) {
+                record_outcome(true);
+                return true;
+            }
+            telemetry_.bump(telemetry_.validation_failures);
+            record_outcome(false);
+            return false;
+        }
+
+        static bool server_responds(database_connection& conn) noexcept {
+            try {
+                PQclear(conn.execute("SELECT 1"));
+                return true;
+            } catch (...) {
+                return false;
+            }
+        }
+
+        pooled_connection hand_out(detail::connection_slot& slot) noexcept {
+            telemetry_.bump(telemetry_.acquires);
+            slot.checked_out_at = std::chrono::steady_clock::now();
+            slot.round_trips_at_checkout = slot.conn->round_trips();
+            return pooled_connection(this, &slot);
+        }
+
+        void connect_slot(detail::connection_slot& slot) {
+            if (slot.conn) {
+                slot.conn.reset();
+                connections_.fetch_sub(1, std::memory_order_relaxed);
+            }
+            install(slot, create_connection());
+        }
+
+        // Put a newly established connection into a slot
+        void install(detail::connection_slot& slot, std::unique_ptr<database_connection> conn) {
             // Set io_context if provided (enables async operations)
             if (config_.io_context) {
                 conn->set_io_context(*config_.io_context);
             }
+            if (slot.conn) {
+                connections_.fetch_sub(1, std::memory_order_relaxed);
+            }
+            slot.conn = std::move(conn);
+            slot.created_at = std::chrono::steady_clock::now();
+            slot.last_used = slot.created_at;
+            slot.retire_at = retirement_time(slot.created_at);
+            connections_.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        // Spread retirements so connections opened together are not all
+        // replaced in the same maintenance pass
+        std::chrono::steady_clock::time_point retirement_time(std::chrono::steady_clock::time_point created) const {
+            if (config_.max_lifetime.count() <= 0) {
+                return std::chrono::steady_clock::time_point::max();
+            }
+            thread_local std::minstd_rand rng{std::random_device{}()};
+            auto lifetime = std::chrono::duration_cast<std::chrono::milliseconds>(config_.max_lifetime);
+            std::uniform_int_distribution<std::int64_t> jitter(0, lifetime.count() / 8);
+            return created + lifetime - std::chrono::milliseconds{jitter(rng)};
+        }
+
+        // Count a returned connection out of the concurrency limit, fed with
+        // the mean round trip of the queries run on it. A connection that ran
+        // none (or was replaced meanwhile) says nothing about the server.
+        void release_limit(const detail::connection_slot& slot) noexcept {
+            auto before = slot.round_trips_at_checkout;
+            auto after = slot.conn ? slot.conn->round_trips() : before;
+            if (after.count > before.count && after.total >= before.total) {
+                auto queries = static_cast<std::int64_t>(after.count - before.count);
+                limiter_->release((after.total - before.total) / queries);
+            } else {
+                limiter_->release();
+            }
+        }
+
+        // Called by pooled_connection when a handle is destroyed
+        void return_connection(detail::connection_slot& slot) noexcept {
+            auto now = std::chrono::steady_clock::now();
+            telemetry_.hold_time.record(now - slot.checked_out_at);
+            if (limiter_) {
+                release_limit(slot);
+            }
+            // Discard connection if shutting down, if it is dead or if it cannot
+            // be made clean for the next borrower
+            if (!shutdown_.load(std::memory_order_acquire) && slot.conn && slot.conn->is_connected() &&
+                prepare_for_reuse(*slot.conn)) {
+                slot.last_used = now;
+                make_idle(slot.index);
+                
+                // shutdown() may have drained the queue between the check and the push
+                if (shutdown_.load(std::memory_order_seq_cst)) {
+                    drain_idle();
+                }
+            } else {
+                discard(slot.index);
+            }
+        }
+
+        void make_idle(std::uint32_t index) noexcept {
+            idle_.push(index);
+            notify_waiter();
+        }
+
+        // Close the slot's connection and make the slot available for a new one
+        void discard(std::uint32_t index) noexcept {
+            if (slots_[index].conn) {
+                slots_[index].conn.reset();
+                connections_.fetch_sub(1, std::memory_order_relaxed);
+            }
+            empty_.push(index);
+            notify_waiter();
+        }
+
+        // Return a slot taken from the queues without being checked out
+        void release_slot(std::uint32_t index, bool has_connection) noexcept {
+            leave();
+            if (has_connection && !shutdown_.load(std::memory_order_acquire)) {
+                make_idle(index);
+            } else {
+                discard(index);
+            }
+        }
+
+        // Hand freshly queued slots to waiters, by priority class and oldest first
+        // Waiters whose deadline has passed are failed instead of being handed
+        // a connection they no longer have time to use.
+        void notify_waiter() noexcept {
+            // Pairs with the waiter's increment before its re-check
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (waiters_.load(std::memory_order_relaxed) == 0) return;
             
-            return conn;
+            auto now = std::chrono::steady_clock::now();
+            std::lock_guard<std::mutex> lock(wait_mutex_);
+            while (auto* waiter = waiting_.next()) {
+                if (breaker_ && breaker_->state() == circuit_state::open) {
+                    waiting_.remove(*waiter);
+                    waiters_.fetch_sub(1, std::memory_order_relaxed);
+                    waiter->rejected = true;
+                    waiter->wake();
+                    continue;
+                }
+                if (waiter->deadline <= now) {
+                    waiting_.remove(*waiter);
+                    waiters_.fetch_sub(1, std::memory_order_relaxed);
+                    waiter->expired = true;
+                    waiter->wake();
+                    continue;
+                }
+                
+                std::uint32_t index;
+                bool needs_connect;
+                if (!try_take(index, needs_connect)) break;
+                
+                waiting_.take(*waiter);
+                waiters_.fetch_sub(1, std::memory_order_relaxed);
+                waiter->index = index;
+                waiter->needs_connect = needs_connect;
+                waiter->granted = true;
+                waiter->wake();
+            }
         }
 
-        void return_connection(std::unique_ptr<database_connection> conn) {
-            std::lock_guard<std::mutex> lock(mutex_);
+        void drain_idle() noexcept {
+            std::uint32_t index;
+            while (idle_.try_pop(index)) {
+                discard(index);
+            }
+        }
+
+        // Connect up to count empty slots and make them idle
+        // The handshakes run side by side on a private io_context, so filling the
+        // pool costs about one connect latency instead of count of them. Returns
+        // the number connected; the first failure's message goes to *error.
+        size_t connect_empty_slots(size_t count, std::string* error = nullptr) {
+            net::io_context ioc;
+            size_t connected = 0;
+            
+            for (size_t i = 0; i < count; ++i) {
+                std::uint32_t index;
+                if (!empty_.try_pop(index)) break;
+                net::co_spawn(ioc, connect_empty_slot(index, connected, error), net::detached);
+            }
             
-            if (shutdown_) {
-                return; // Discard connection if shutting down
+            ioc.run();
+            return connected;
+        }
+
+        net::awaitable<void> connect_empty_slot(std::uint32_t index, size_t& connected, std::string* error) {
+            slot_guard guard{this, index};
+            try {
+                install(slots_[index], co_await async_create_connection());
+                guard.pool = nullptr;
+                make_idle(index);
+                ++connected;
+            } catch (const database_error& e) {
+                if (error && error->empty()) *error = e.what();
             }
+        }
 
-            --active_connections_;
+        // Replenish pool to minimum connections
+        // Not while the circuit breaker is open or probing: reconnecting is
+        // left to the probes.
+        void replenish() {
+            if (breaker_ && breaker_->state() != circuit_state::closed) return;
             
-            // Check if connection is still valid
-            if (conn && conn->is_connected()) {
-                available_connections_.push(std::move(conn));
-                cv_.notify_one();
-            } else {
-                // Connection is dead, don't return it to pool
-                cv_.notify_one();
+            size_t total = connections_.load(std::memory_order_relaxed);
+            if (total >= config_.min_connections) return;
+            
+            std::string error;
+            connect_empty_slots(config_.min_connections - total, &error);
+            if (!error.empty()) {
+                std::cerr << "Failed to replenish pool: " << error << std::endl;
             }
         }
 
         pool_config config_;
-        mutable std::mutex mutex_;
-        std::condition_variable cv_;
-        std::queue<std::unique_ptr<database_connection>> available_connections_;
-        size_t active_connections_;
-        bool shutdown_;
+        std::string conninfo_;
+        std::unique_ptr<detail::connection_slot[]> slots_;
+        detail::idle_list idle_;              // Slots holding an idle connection
+        detail::bounded_index_queue empty_;   // Slots without a connection
+        std::atomic<size_t> connections_{0};  // Slots holding a connection
+        std::atomic<size_t> held_for_maintenance_{0};  // maintain() calls with idle connections out
+        std::atomic<bool> shutdown_{false};
+        
+        // Slow path only
+        std::atomic<size_t> waiters_{0};      // Queued or registering waiters
+        std::mutex wait_mutex_;
+        detail::waiter_queue waiting_;
+        
+        detail::pool_telemetry telemetry_;
+        std::unique_ptr<detail::gradient_limiter> limiter_;  // Null unless adaptive_limit.enabled
+        std::unique_ptr<detail::circuit_breaker> breaker_;   // Null unless circuit_breaker.enabled
+        
+        std::jthread maintenance_thread_;
     };
 
-} // namespace fenrir
\ No newline at end of file
+    // Async acquire implementation
+    inline net::awaitable<pooled_connection> database_pool::async_acquire(
+        std::chrono::milliseconds timeout, acquire_priority priority) {
+        
+        if (shutdown_.load(std::memory_order_acquire)) {
+            throw database_error{"Pool is shutting down"};
+        }
+        reject_if_open();
+        
+        std::uint32_t index;
+        bool needs_connect = false;
+        if (try_take_unqueued(index, needs_connect)) {
+            telemetry_.acquire_wait.record_us(0);
+        } else {
+            reject_if_limited();
+            auto start = std::chrono::steady_clock::now();
+            boost::system::error_code ec;
+            std::tie(index, needs_connect) = co_await async_wait_for_slot(
+                start + timeout, priority,
+                net::redirect_error(net::use_awaitable, ec));
+            
+            if (ec == net::error::timed_out) {
+                telemetry_.bump(telemetry_.timeouts);
+                throw pool_busy_error{"Timeout waiting for connection"};
+            } else if (ec == net::error::connection_refused) {
+                telemetry_.bump(telemetry_.breaker_rejections);
+                throw database_error{"Circuit breaker open"};
+            } else if (ec == net::error::shut_down) {
+                throw database_error{"Pool is shutting down"};
+            } else if (ec) {
+                throw boost::system::system_error(ec);
+            }
+            telemetry_.acquire_wait.record(std::chrono::steady_clock::now() - start);
+        }
+        co_return co_await async_checkout(index, needs_connect);
+    }
+
+    inline void pooled_connection::release() noexcept {
+        if (pool_ && slot_) {
+            pool_->return_connection(*slot_);
+        }
+        pool_ = nullptr;
+        slot_ = nullptr;
+    }
+
+    inline bool pooled_connection::try_reconnect() {
+        if (!pool_ || !slot_) return false;
+        
+        // A lost connection counts against the circuit breaker, and while it
+        // is open the handle fails instead of reconnecting into the outage
+        pool_->record_outcome(false);
+        if (!pool_->breaker_allows()) return false;
+        
+        pool_->telemetry_.bump(pool_->telemetry_.reconnects);
+        try {
+            // First try to reset existing connection
+            if (slot_->conn) {
+                try {
+                    slot_->conn->reset();
+                    if (slot_->conn->is_connected()) {
+                        pool_->warm_up(*slot_->conn);
+                        return true;
+                    }
+                } catch (...) {
+                    // Reset failed, will create new connection
+                }
+            }
+            
+            // Create fresh connection
+            pool_->connect_slot(*slot_);
+            return slot_->conn && slot_->conn->is_connected();
+        } catch (const std::exception&) {
+            return false;
+        }
+    }
+
+    inline net::awaitable<bool> pooled_connection::async_reconnect() {
+        if (!pool_ || !slot_) co_return false;
+        
+        pool_->record_outcome(false);
+        if (!pool_->breaker_allows()) co_return false;
+        
+        pool_->telemetry_.bump(pool_->telemetry_.reconnects);
+        try {
+            pool_->install(*slot_, co_await pool_->async_create_connection());
+        } catch (const std::exception&) {
+            co_return false;
+        }
+        co_return slot_->conn && slot_->conn->is_connected();
+    }
+
+    inline retry_reason pooled_connection::retry_reason_of(const database_error& error) const noexcept {
+        if (pool_ && pool_->circuit_open()) return retry_reason::none;
+        return classify_error(error, is_healthy());
+    }
+
+    inline void pooled_connection::count_retry() noexcept {
+        if (pool_) pool_->telemetry_.bump(pool_->telemetry_.retries);
+    }
+
+} // namespace fenrir
@@ -0,0 +1,246 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <format>
+#include <string>
+#include <string_view>
+
+namespace fenrir {
+
+    // Bucketed latency distribution (read side of latency_histogram)
+    struct histogram_snapshot {
+        // Upper bounds of the finite buckets in microseconds; the last bucket
+        // counts everything slower
+        static constexpr std::array<std::uint64_t, 19> bounds_us{
+            10, 25, 50, 100, 250, 500,
+            1'000, 2'500, 5'000, 10'000, 25'000, 50'000,
+            100'000, 250'000, 500'000, 1'000'000, 2'500'000, 5'000'000, 10'000'000
+        };
+        static constexpr size_t bucket_count = bounds_us.size() + 1;
+
+        std::array<std::uint64_t, bucket_count> buckets{};  // Per bucket, not cumulative
+        std::uint64_t count = 0;
+        std::uint64_t sum_us = 0;
+
+        [[nodiscard]] std::chrono::microseconds mean() const noexcept {
+            return std::chrono::microseconds{count ? sum_us / count : 0};
+        }
+
+        // Upper bound of the bucket holding quantile q (0..1); the largest
+        // finite bound when it falls in the overflow bucket
+        [[nodiscard]] std::chrono::microseconds quantile(double q) const noexcept {
+            auto rank = static_cast<std::uint64_t>(q * static_cast<double>(count));
+            std::uint64_t seen = 0;
+            for (size_t i = 0; i < bounds_us.size(); ++i) {
+                seen += buckets[i];
+                if (seen > rank || (seen == count && count > 0)) {
+                    return std::chrono::microseconds{bounds_us[i]};
+                }
+            }
+            return std::chrono::microseconds{bounds_us.back()};
+        }
+
+        histogram_snapshot& operator+=(const histogram_snapshot& other) noexcept {
+            for (size_t i = 0; i < bucket_count; ++i) {
+                buckets[i] += other.buckets[i];
+            }
+            count += other.count;
+            sum_us += other.sum_us;
+            return *this;
+        }
+    };
+
+    // Lock-free latency histogram
+    // record() is two relaxed fetch_adds; snapshot() may be mid-update under
+    // concurrent use, like database_pool::get_stats().
+    class latency_histogram {
+    public:
+        void record(std::chrono::steady_clock::duration elapsed) noexcept {
+            auto us = std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+            record_us(us > 0 ? static_cast<std::uint64_t>(us) : 0);
+        }
+
+        void record_us(std::uint64_t us) noexcept {
+            size_t bucket = 0;
+            while (bucket < histogram_snapshot::bounds_us.size() && us > histogram_snapshot::bounds_us[bucket]) {
+                ++bucket;
+            }
+            buckets_[bucket].fetch_add(1, std::memory_order_relaxed);
+            sum_us_.fetch_add(us, std::memory_order_relaxed);
+        }
+
+        [[nodiscard]] histogram_snapshot snapshot() const noexcept {
+            histogram_snapshot result;
+            for (size_t i = 0; i < histogram_snapshot::bucket_count; ++i) {
+                result.buckets[i] = buckets_[i].load(std::memory_order_relaxed);
+                result.count += result.buckets[i];
+            }
+            result.sum_us = sum_us_.load(std::memory_order_relaxed);
+            return result;
+        }
+
+    private:
+        std::array<std::atomic<std::uint64_t>, histogram_snapshot::bucket_count> buckets_{};
+        std::atomic<std::uint64_t> sum_us_{0};
+    };
+
+    // Point-in-time copy of a pool's telemetry
+    struct pool_metrics {
+        // Gauges, as in database_pool::pool_stats
+        size_t active_connections = 0;
+        size_t available_connections = 0;
+        size_t total_connections = 0;
+        size_t max_connections = 0;
+        size_t waiting = 0;
+        size_t concurrency_limit = 0;           // Adaptive limit, or max_connections without one
+        size_t open_circuits = 0;               // 1 while the circuit breaker is open or half-open
+
+        // Counters since the pool was created
+        std::uint64_t acquires = 0;
+        std::uint64_t timeouts = 0;             // Acquires that gave up waiting
+        std::uint64_t rejections = 0;           // Acquires refused at the concurrency limit
+        std::uint64_t breaker_rejections = 0;   // Acquires failed fast by the circuit breaker
+        std::uint64_t connects = 0;             // Connections established
+        std::uint64_t connect_failures = 0;
+        std::uint64_t reconnects = 0;           // Dead connections reset or replaced on a handle
+        std::uint64_t retries = 0;              // Operations run again by execute_with_retry()
+        std::uint64_t validations = 0;          // validate_on_acquire checks
+        std::uint64_t validation_failures = 0;  // ...that found the connection dead
+
+        histogram_snapshot acquire_wait;     // Call to slot claimed: time spent on a saturated pool
+        histogram_snapshot hold_time;        // Checkout to return of a handle
+        histogram_snapshot connect_latency;  // Connection establishment, successful or not
+
+        pool_metrics& operator+=(const pool_metrics& other) noexcept {
+            active_connections += other.active_connections;
+            available_connections += other.available_connections;
+            total_connections += other.total_connections;
+            max_connections += other.max_connections;
+            waiting += other.waiting;
+            concurrency_limit += other.concurrency_limit;
+            open_circuits += other.open_circuits;
+            acquires += other.acquires;
+            timeouts += other.timeouts;
+            rejections += other.rejections;
+            breaker_rejections += other.breaker_rejections;
+            connects += other.connects;
+            connect_failures += other.connect_failures;
+            reconnects += other.reconnects;
+            retries += other.retries;
+            validations += other.validations;
+            validation_failures += other.validation_failures;
+            acquire_wait += other.acquire_wait;
+            hold_time += other.hold_time;
+            connect_latency += other.connect_latency;
+            return *this;
+        }
+
+        // Prometheus text exposition format
+        // labels is added to every sample as-is, e.g. R"(pool="orders")".
+        [[nodiscard]] std::string to_prometheus(std::string_view prefix = "fenrir_pool",
+                                                std::string_view labels = {}) const {
+            std::string out;
+            auto sample = [&](std::string_view name, std::string_view extra, double value) {
+                std::string all_labels(labels);
+                if (!extra.empty()) {
+                    if (!all_labels.empty()) all_labels += ',';
+                    all_labels += extra;
+                }
+                if (all_labels.empty()) {
+                    out += std::format("{}_{} {}\n", prefix, name, value);
+                } else {
+                    out += std::format("{}_{}{{{}}} {}\n", prefix, name, all_labels, value);
+                }
+            };
+            auto metric = [&](std::string_view name, std::string_view type, std::string_view help, double value) {
+                out += std::format("# HELP {}_{} {}\n# TYPE {}_{} {}\n", prefix, name, help, prefix, name, type);
+                sample(name, {}, value);
+            };
+            auto histogram = [&](std::string_view name, std::string_view help, const histogram_snapshot& h) {
+                out += std::format("# HELP {}_{} {}\n# TYPE {}_{} histogram\n", prefix, name, help, prefix, name);
+                std::string bucket_name = std::format("{}_bucket", name);
+                std::uint64_t cumulative = 0;
+                for (size_t i = 0; i < histogram_snapshot::bounds_us.size(); ++i) {
+                    cumulative += h.buckets[i];
+                    sample(bucket_name, std::format("le=\"{}\"", histogram_snapshot::bounds_us[i] / 1e6),
+                           static_cast<double>(cumulative));
+                }
+                sample(bucket_name, "le=\"+Inf\"", static_cast<double>(h.count));
+                sample(std::format("{}_sum", name), {}, static_cast<double>(h.sum_us) / 1e6);
+                sample(std::format("{}_count", name), {}, static_cast<double>(h.count));
+            };
+
+            metric("connections_active", "gauge", "Connections checked out", static_cast<double>(active_connections));
+            metric("connections_idle", "gauge", "Connections idle in the pool", static_cast<double>(available_connections));
+            metric("connections_total", "gauge", "Connections open", static_cast<double>(total_connections));
+            metric("connections_max", "gauge", "Pool capacity", static_cast<double>(max_connections));
+            metric("waiters", "gauge", "Callers waiting for a connection", static_cast<double>(waiting));
+            metric("concurrency_limit", "gauge", "Connections allowed in use at once",
+                   static_cast<double>(concurrency_limit));
+            metric("circuit_open", "gauge", "Whether the circuit breaker is failing acquires fast",
+                   static_cast<double>(open_circuits));
+            metric("acquires_total", "counter", "Connections handed out", static_cast<double>(acquires));
+            metric("acquire_timeouts_total", "counter", "Acquires that timed out", static_cast<double>(timeouts));
+            metric("acquire_rejections_total", "counter", "Acquires refused at the concurrency limit",
+                   static_cast<double>(rejections));
+            metric("breaker_rejections_total", "counter", "Acquires failed fast by the circuit breaker",
+                   static_cast<double>(breaker_rejections));
+            metric("connects_total", "counter", "Connections established", static_cast<double>(connects));
+            metric("connect_failures_total", "counter", "Failed connection attempts", static_cast<double>(connect_failures));
+            metric("reconnects_total", "counter", "Dead connections reset or replaced", static_cast<double>(reconnects));
+            metric("retries_total", "counter", "Operations retried after a transient failure", static_cast<double>(retries));
+            metric("validations_total", "counter", "Connection checks on acquire", static_cast<double>(validations));
+            metric("validation_failures_total", "counter", "Connection checks that found it dead",
+                   static_cast<double>(validation_failures));
+            histogram("acquire_wait_seconds", "Time waiting for a free connection slot", acquire_wait);
+            histogram("hold_seconds", "Time connections stay checked out", hold_time);
+            histogram("connect_seconds", "Connection establishment latency", connect_latency);
+            return out;
+        }
+    };
+
+    namespace detail {
+
+        // Write side of pool_metrics, owned by database_pool
+        struct pool_telemetry {
+            std::atomic<std::uint64_t> acquires{0};
+            std::atomic<std::uint64_t> timeouts{0};
+            std::atomic<std::uint64_t> rejections{0};
+            std::atomic<std::uint64_t> breaker_rejections{0};
+            std::atomic<std::uint64_t> connects{0};
+            std::atomic<std::uint64_t> connect_failures{0};
+            std::atomic<std::uint64_t> reconnects{0};
+            std::atomic<std::uint64_t> retries{0};
+            std::atomic<std::uint64_t> validations{0};
+            std::atomic<std::uint64_t> validation_failures{0};
+            latency_histogram acquire_wait;
+            latency_histogram hold_time;
+            latency_histogram connect_latency;
+
+            static void bump(std::atomic<std::uint64_t>& counter) noexcept {
+                counter.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            void copy_to(pool_metrics& metrics) const noexcept {
+                metrics.acquires = acquires.load(std::memory_order_relaxed);
+                metrics.timeouts = timeouts.load(std::memory_order_relaxed);
+                metrics.rejections = rejections.load(std::memory_order_relaxed);
+                metrics.breaker_rejections = breaker_rejections.load(std::memory_order_relaxed);
+                metrics.connects = connects.load(std::memory_order_relaxed);
+                metrics.connect_failures = connect_failures.load(std::memory_order_relaxed);
+                metrics.reconnects = reconnects.load(std::memory_order_relaxed);
+                metrics.retries = retries.load(std::memory_order_relaxed);
+                metrics.validations = validations.load(std::memory_order_relaxed);
+                metrics.validation_failures = validation_failures.load(std::memory_order_relaxed);
+                metrics.acquire_wait = acquire_wait.snapshot();
+                metrics.hold_time = hold_time.snapshot();
+                metrics.connect_latency = connect_latency.snapshot();
+            }
+        };
+
+    } // namespace detail
+
+} // namespace fenrir
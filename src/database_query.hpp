@@ -1,14 +1,23 @@
 #pragma once
 
 #include <libpq-fe.h>
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <functional>
 #include <memory>
 #include <optional>
+#include <string>
 #include <vector>
 #include <unordered_map>
 #include <concepts>
 #include <ranges>
 #include <span>
+#include <tuple>
 #include <type_traits>
+#include <utility>
+#include "database_query_plan.hpp"
 
 namespace fenrir {
 
@@ -28,14 +37,22 @@ namespace fenrir {
              bool HasFrom = false,
              bool HasWhere = false,
              bool HasSet = false,
-             bool HasValues = false>
+             bool HasValues = false,
+             bool HasTail = false>
     struct query_state {
         using query_type = QueryType;
         static constexpr bool has_from = HasFrom;
         static constexpr bool has_where = HasWhere;
         static constexpr bool has_set = HasSet;
         static constexpr bool has_values = HasValues;
+        static constexpr bool has_tail = HasTail;   // GROUP BY, HAVING, ORDER BY, LIMIT or OFFSET appended
     };
+
+    // State after a clause that must follow WHERE: GROUP BY, HAVING, ORDER BY,
+    // LIMIT or OFFSET
+    template<typename State>
+    using with_tail = query_state<typename State::query_type, State::has_from, State::has_where,
+                                  State::has_set, State::has_values, true>;
     
     // Default initial state
     using initial_query_state = query_state<>;
@@ -257,6 +274,961 @@ namespace fenrir {
         std::unique_ptr<PGresult, decltype(&PQclear)> result_;
     };
 
+    // ============================================================================
+    // Typed Prepared Statements
+    // ============================================================================
+
+    namespace detail {
+
+        // Built-in PostgreSQL type OIDs used for binary parameter encoding
+        inline constexpr Oid bool_oid = 16;
+        inline constexpr Oid int8_oid = 20;
+        inline constexpr Oid int2_oid = 21;
+        inline constexpr Oid int4_oid = 23;
+        inline constexpr Oid float4_oid = 700;
+        inline constexpr Oid float8_oid = 701;
+
+        // Array type OIDs for the element types above
+        inline constexpr Oid bool_array_oid = 1000;
+        inline constexpr Oid int2_array_oid = 1005;
+        inline constexpr Oid int4_array_oid = 1007;
+        inline constexpr Oid int8_array_oid = 1016;
+        inline constexpr Oid float4_array_oid = 1021;
+        inline constexpr Oid float8_array_oid = 1022;
+
+        // Server type for a scalar C++ type with a binary encoding (0 if none)
+        template<typename T>
+        constexpr Oid scalar_oid() {
+            using U = std::remove_cvref_t<T>;
+            if constexpr (is_optional<U>::value) {
+                return scalar_oid<typename U::value_type>();
+            } else if constexpr (std::is_same_v<U, bool>) {
+                return bool_oid;
+            } else if constexpr (std::is_integral_v<U> && std::is_signed_v<U>) {
+                if constexpr (sizeof(U) == 2) return int2_oid;
+                else if constexpr (sizeof(U) == 4) return int4_oid;
+                else if constexpr (sizeof(U) == 8) return int8_oid;
+                else return 0;
+            } else if constexpr (std::is_same_v<U, float>) {
+                return float4_oid;
+            } else if constexpr (std::is_same_v<U, double>) {
+                return float8_oid;
+            } else {
+                return 0;
+            }
+        }
+
+        template<typename R>
+        using array_element_t = std::remove_cvref_t<std::ranges::range_value_t<R>>;
+
+        // One-dimensional arrays of scalars are sent in binary array format
+        template<typename T>
+        concept binary_array_param =
+            array_param<T> && !array_param<array_element_t<T>> &&
+            scalar_oid<array_element_t<T>>() != 0;
+
+        // Server type for a C++ parameter type (0 lets the server infer it)
+        template<typename T>
+        constexpr Oid param_oid() {
+            using U = std::remove_cvref_t<T>;
+            if constexpr (is_optional<U>::value) {
+                return param_oid<typename U::value_type>();
+            } else if constexpr (binary_array_param<U>) {
+                switch (scalar_oid<array_element_t<U>>()) {
+                    case bool_oid: return bool_array_oid;
+                    case int2_oid: return int2_array_oid;
+                    case int4_oid: return int4_array_oid;
+                    case int8_oid: return int8_array_oid;
+                    case float4_oid: return float4_array_oid;
+                    case float8_oid: return float8_array_oid;
+                    default: return 0;
+                }
+            } else {
+                return scalar_oid<U>();
+            }
+        }
+
+        // A call argument is accepted if it is exactly the declared type, or a
+        // string-like value for a declared string parameter
+        template<typename From, typename To>
+        concept exact_param =
+            std::same_as<std::remove_cvref_t<From>, To> ||
+            ((std::same_as<To, std::string> || std::same_as<To, std::string_view>) &&
+             std::convertible_to<From, To>);
+
+        // Write an unsigned integer in network byte order
+        template<typename UInt>
+        inline void store_big_endian(char* dst, UInt value) noexcept {
+            for (std::size_t i = 0; i < sizeof(UInt); ++i) {
+                dst[i] = static_cast<char>((value >> (8 * (sizeof(UInt) - 1 - i))) & 0xFF);
+            }
+        }
+
+        // Binary representation of a scalar with scalar_oid<T>() != 0
+        // Writes at most 8 bytes to dst and returns the length.
+        template<typename T>
+        inline std::size_t encode_scalar(const T& value, char* dst) noexcept {
+            if constexpr (std::is_same_v<T, bool>) {
+                dst[0] = value ? 1 : 0;
+                return 1;
+            } else if constexpr (std::is_integral_v<T>) {
+                store_big_endian(dst, static_cast<std::make_unsigned_t<T>>(value));
+                return sizeof(T);
+            } else if constexpr (std::is_same_v<T, float>) {
+                store_big_endian(dst, std::bit_cast<std::uint32_t>(value));
+                return sizeof(float);
+            } else {
+                store_big_endian(dst, std::bit_cast<std::uint64_t>(value));
+                return sizeof(double);
+            }
+        }
+
+        // Binary array wire format: ndim, has-null flag, element OID,
+        // (length, lower bound) per dimension, then (length, bytes) per element
+        template<typename R>
+        void encode_binary_array(const R& values, std::string& out) {
+            using E = array_element_t<R>;
+            auto append_int32 = [&out](std::uint32_t v) {
+                char buf[4];
+                store_big_endian(buf, v);
+                out.append(buf, 4);
+            };
+
+            std::size_t count = 0;
+            bool has_null = false;
+            for (const auto& value : values) {
+                ++count;
+                if constexpr (is_optional<E>::value) {
+                    has_null = has_null || !value.has_value();
+                }
+            }
+
+            out.clear();
+            append_int32(count ? 1 : 0);
+            append_int32(has_null ? 1 : 0);
+            append_int32(scalar_oid<E>());
+            if (count) {
+                append_int32(static_cast<std::uint32_t>(count));
+                append_int32(1);
+            }
+
+            char buf[8];
+            for (const auto& value : values) {
+                if constexpr (is_optional<E>::value) {
+                    if (!value.has_value()) {
+                        append_int32(static_cast<std::uint32_t>(-1));
+                        continue;
+                    }
+                    std::size_t length = encode_scalar(*value, buf);
+                    append_int32(static_cast<std::uint32_t>(length));
+                    out.append(buf, length);
+                } else {
+                    std::size_t length = encode_scalar(value, buf);
+                    append_int32(static_cast<std::uint32_t>(length));
+                    out.append(buf, length);
+                }
+            }
+        }
+
+        // Encoded form of one statement parameter
+        // Scalars and scalar arrays are written in binary format; strings are
+        // passed as text. value == nullptr encodes SQL NULL.
+        struct encoded_param {
+            const char* value = nullptr;
+            int length = 0;
+            int format = 0;
+            std::array<char, 8> binary{};
+            std::string text;
+        };
+
+        // Encode value into slot. The slot must not move until the parameter is sent.
+        template<typename T>
+        void encode_param(const T& value, encoded_param& slot) {
+            if constexpr (is_optional<T>::value) {
+                if (!value.has_value()) {
+                    slot.value = nullptr;  // SQL NULL
+                    return;
+                }
+                encode_param(*value, slot);
+            } else if constexpr (scalar_oid<T>() != 0) {
+                slot.length = static_cast<int>(encode_scalar(value, slot.binary.data()));
+                slot.value = slot.binary.data();
+                slot.format = 1;
+            } else if constexpr (binary_array_param<T>) {
+                encode_binary_array(value, slot.text);
+                slot.value = slot.text.data();
+                slot.length = static_cast<int>(slot.text.size());
+                slot.format = 1;
+            } else if constexpr (array_param<T>) {
+                slot.text = array_literal(value);
+                slot.value = slot.text.c_str();
+            } else if constexpr (std::is_same_v<T, std::string>) {
+                slot.value = value.c_str();
+            } else if constexpr (std::is_convertible_v<T, const char*>) {
+                slot.value = value;
+            } else if constexpr (std::is_same_v<T, std::string_view>) {
+                slot.text = std::string(value);
+                slot.value = slot.text.c_str();
+            } else {
+                slot.text = std::format("{}", value);
+                slot.value = slot.text.c_str();
+            }
+        }
+
+        // Fixed-size parameter block for one statement execution
+        // No heap allocation unless a value must be copied or formatted.
+        template<typename... Args>
+        class param_buffer {
+        public:
+            static constexpr std::size_t count = sizeof...(Args);
+
+            explicit param_buffer(const Args&... args) {
+                std::size_t index = 0;
+                (encode(index++, args), ...);
+            }
+
+            // Pointers refer into this object, so it must stay in place
+            param_buffer(const param_buffer&) = delete;
+            param_buffer& operator=(const param_buffer&) = delete;
+
+            [[nodiscard]] int size() const noexcept { return static_cast<int>(count); }
+            [[nodiscard]] const char* const* values() const noexcept { return values_.data(); }
+            [[nodiscard]] const int* lengths() const noexcept { return lengths_.data(); }
+            [[nodiscard]] const int* formats() const noexcept { return formats_.data(); }
+
+        private:
+            template<typename T>
+            void encode(std::size_t i, const T& value) {
+                encode_param(value, slots_[i]);
+                values_[i] = slots_[i].value;
+                lengths_[i] = slots_[i].length;
+                formats_[i] = slots_[i].format;
+            }
+
+            std::array<encoded_param, count> slots_{};
+            std::array<const char*, count> values_{};
+            std::array<int, count> lengths_{};
+            std::array<int, count> formats_{};
+        };
+
+        // SQL type name for a C++ parameter type (used for array casts)
+        template<typename T>
+        constexpr std::string_view param_type_name() {
+            switch (scalar_oid<T>()) {
+                case bool_oid: return "bool";
+                case int2_oid: return "int2";
+                case int4_oid: return "int4";
+                case int8_oid: return "int8";
+                case float4_oid: return "float4";
+                case float8_oid: return "float8";
+                default: return "text";
+            }
+        }
+
+        // Result column metadata reported by PQdescribePrepared
+        struct column_description {
+            std::string name;
+            Oid type;
+        };
+
+        // Everything needed to (re)prepare and run a statement on any connection
+        struct statement_descriptor {
+            std::string name;
+            std::string sql;
+            std::vector<Oid> param_types;
+            std::vector<column_description> columns;
+        };
+
+        // Deterministic server-side name for a statement text and parameter types
+        [[nodiscard]] inline std::string statement_name(std::string_view sql,
+                                                        std::span<const Oid> param_types) {
+            std::string key(sql);
+            for (Oid oid : param_types) {
+                key += std::format(",{}", oid);
+            }
+            return std::format("fenrir_stmt_{:016x}", std::hash<std::string>{}(key));
+        }
+
+        // Prepare the statement on this connection if the session lacks it
+        inline void ensure_prepared(database_connection& conn, const statement_descriptor& desc) {
+            if (!conn.is_prepared(desc.name)) {
+                conn.prepare(desc.name, desc.sql, desc.param_types);
+            }
+        }
+
+        template<typename... Args>
+        [[nodiscard]] query_result run_prepared(
+            database_connection& conn, const statement_descriptor& desc, const Args&... args) {
+            ensure_prepared(conn, desc);
+            param_buffer<Args...> params(args...);
+            return query_result(conn.execute_prepared_raw(
+                desc.name, params.size(), params.values(), params.lengths(), params.formats()));
+        }
+
+        template<typename... Args>
+        [[nodiscard]] net::awaitable<query_result> run_prepared_async(
+            database_connection& conn, const statement_descriptor& desc, const Args&... args) {
+            if (!conn.is_prepared(desc.name)) {
+                co_await conn.async_prepare(desc.name, desc.sql, desc.param_types);
+            }
+            param_buffer<Args...> params(args...);
+            co_return co_await conn.async_execute_prepared_raw(
+                desc.name, params.size(), params.values(), params.lengths(), params.formats());
+        }
+
+        // Prepare on conn and capture the server's description of the statement
+        template<typename... Args>
+        [[nodiscard]] std::shared_ptr<const statement_descriptor> describe_statement(
+            database_connection& conn, std::string sql) {
+            
+            auto desc = std::make_shared<statement_descriptor>();
+            desc->param_types = {param_oid<Args>()...};
+            desc->name = statement_name(sql, desc->param_types);
+            desc->sql = std::move(sql);
+
+            ensure_prepared(conn, *desc);
+            query_result described(conn.describe_prepared(desc->name));
+            PGresult* res = described.native_handle();
+
+            if (PQnparams(res) != static_cast<int>(sizeof...(Args))) {
+                throw database_error{std::format(
+                    "Prepared statement expects {} parameters but {} were declared",
+                    PQnparams(res), sizeof...(Args))};
+            }
+
+            desc->columns.reserve(PQnfields(res));
+            for (int col = 0; col < PQnfields(res); ++col) {
+                desc->columns.push_back(column_description{
+                    .name = PQfname(res, col),
+                    .type = PQftype(res, col)
+                });
+            }
+            return desc;
+        }
+
+    } // namespace detail
+
+    // Handle to a server-side prepared statement with a fixed parameter list
+    // Obtained from typed_query_builder::prepare<Args...>(). Calls accept exactly
+    // the declared argument types; scalars are sent in binary format.
+    template<typename... Args>
+    class prepared_statement {
+    public:
+        prepared_statement(std::shared_ptr<const detail::statement_descriptor> desc,
+                           database_connection& conn)
+            : desc_(std::move(desc)), conn_(&conn) {}
+
+        // Pool-bound statement: each call acquires a connection and prepares
+        // the statement on it the first time that connection sees it
+        // (execute_async() waits for the connection with async_acquire()).
+        // The statement keeps a reference to pool, which must outlive it.
+        template<typename Pool>
+        requires requires(Pool& pool) { *pool.acquire(); pool.async_acquire(); }
+        prepared_statement(std::shared_ptr<const detail::statement_descriptor> desc, Pool& pool)
+            : desc_(std::move(desc)), conn_(nullptr) {
+            pooled_sync_ = [&pool](const detail::statement_descriptor& d, const Args&... args) {
+                auto conn = pool.acquire();
+                return detail::run_prepared(*conn, d, args...);
+            };
+            pooled_async_ = [&pool](const detail::statement_descriptor& d, const Args&... args)
+                -> net::awaitable<query_result> {
+                auto conn = co_await pool.async_acquire();
+                co_return co_await detail::run_prepared_async(*conn, d, args...);
+            };
+        }
+
+        // Execute synchronously
+        template<typename... CallArgs>
+        requires (sizeof...(CallArgs) == sizeof...(Args) &&
+                  (detail::exact_param<CallArgs, Args> && ...))
+        [[nodiscard]] query_result operator()(CallArgs&&... args) const {
+            if (conn_) {
+                return detail::run_prepared(*conn_, *desc_, static_cast<const Args&>(args)...);
+            }
+            return pooled_sync_(*desc_, static_cast<const Args&>(args)...);
+        }
+
+        // Execute asynchronously (connection must have an io_context)
+        template<typename... CallArgs>
+        requires (sizeof...(CallArgs) == sizeof...(Args) &&
+                  (detail::exact_param<CallArgs, Args> && ...))
+        [[nodiscard]] net::awaitable<query_result> execute_async(CallArgs&&... args) const {
+            if (conn_) {
+                co_return co_await detail::run_prepared_async(
+                    *conn_, *desc_, static_cast<const Args&>(args)...);
+            }
+            co_return co_await pooled_async_(*desc_, static_cast<const Args&>(args)...);
+        }
+
+        // Run on an explicitly chosen connection (prepares there if needed)
+        template<typename... CallArgs>
+        requires (sizeof...(CallArgs) == sizeof...(Args) &&
+                  (detail::exact_param<CallArgs, Args> && ...))
+        [[nodiscard]] query_result execute_on(database_connection& conn, CallArgs&&... args) const {
+            return detail::run_prepared(conn, *desc_, static_cast<const Args&>(args)...);
+        }
+
+        // Server-side statement name
+        [[nodiscard]] const std::string& name() const noexcept { return desc_->name; }
+
+        [[nodiscard]] const std::string& sql() const noexcept { return desc_->sql; }
+
+        // Parameter type OIDs sent at prepare time (0 = inferred by server)
+        [[nodiscard]] std::span<const Oid> param_types() const noexcept {
+            return desc_->param_types;
+        }
+
+        // Result columns as described by the server
+        [[nodiscard]] std::span<const detail::column_description> columns() const noexcept {
+            return desc_->columns;
+        }
+
+        // Resolve a result column index from the cached description
+        // (no per-row PQfnumber lookups; positions are stable for this statement)
+        [[nodiscard]] std::optional<int> column_index(std::string_view name) const noexcept {
+            for (std::size_t i = 0; i < desc_->columns.size(); ++i) {
+                if (desc_->columns[i].name == name) {
+                    return static_cast<int>(i);
+                }
+            }
+            return std::nullopt;
+        }
+
+    private:
+        std::shared_ptr<const detail::statement_descriptor> desc_;
+        database_connection* conn_;
+        std::function<query_result(const detail::statement_descriptor&, const Args&...)> pooled_sync_;
+        std::function<net::awaitable<query_result>(const detail::statement_descriptor&,
+                                                   const Args&...)> pooled_async_;
+    };
+
+    // ============================================================================
+    // Batched Multi-Row INSERT
+    // ============================================================================
+
+    // Statement shape used by batch_insert
+    enum class batch_insert_style {
+        values,  // INSERT ... VALUES ($1, $2), ($3, $4), ...  (limited by bind parameters)
+        unnest   // INSERT ... SELECT * FROM unnest($1::T1[], $2::T2[])  (one array per column)
+    };
+
+    // Row types accepted by batch_insert (std::tuple, std::pair, std::array, ...)
+    template<typename T>
+    concept TupleLike = requires { std::tuple_size<std::remove_cvref_t<T>>::value; };
+
+    // Chunked multi-row INSERT built from a range of tuple-like rows
+    // Obtained from typed_query_builder::values_range(). Each chunk is sent as one
+    // parameterized statement; full chunks share a prepared statement. With
+    // pipelined(), all chunks go out in a single round trip and run in one
+    // implicit transaction.
+    template<std::ranges::input_range Rows, typename Proj>
+    class batch_insert {
+    public:
+        using row_type = std::remove_cvref_t<
+            std::invoke_result_t<Proj&, std::ranges::range_reference_t<Rows>>>;
+        static_assert(TupleLike<row_type>,
+                      "values_range rows must be tuple-like; project structs with std::tie");
+
+        static constexpr std::size_t column_count = std::tuple_size_v<row_type>;
+        static constexpr std::size_t max_bind_params = 65535;
+
+        batch_insert(std::shared_ptr<database_connection> owner, database_connection& conn,
+                     std::string insert_prefix, Rows rows, Proj proj)
+            : owner_(std::move(owner)), conn_(&conn), prefix_(std::move(insert_prefix)),
+              rows_(std::move(rows)), proj_(std::move(proj)) {}
+
+        // Maximum rows per statement (VALUES chunks are further capped by the
+        // 65535 bind-parameter limit)
+        batch_insert& chunk_rows(std::size_t rows) {
+            chunk_rows_ = rows > 0 ? rows : 1;
+            return *this;
+        }
+
+        batch_insert& style(batch_insert_style style) {
+            style_ = style;
+            return *this;
+        }
+
+        // Element types for unnest() casts, one per column (default: deduced
+        // from the C++ column types, falling back to text)
+        batch_insert& column_types(std::vector<std::string> types) {
+            column_types_ = std::move(types);
+            return *this;
+        }
+
+        // Send every chunk in one libpq pipeline instead of one round trip each
+        batch_insert& pipelined(bool enable = true) {
+            pipelined_ = enable;
+            return *this;
+        }
+
+        [[nodiscard]] std::size_t rows_per_chunk() const noexcept {
+            if (style_ == batch_insert_style::values) {
+                return std::max<std::size_t>(
+                    1, std::min(chunk_rows_, max_bind_params / column_count));
+            }
+            return chunk_rows_;
+        }
+
+        // SQL for a chunk of the given row count
+        [[nodiscard]] std::string chunk_sql(std::size_t rows) const {
+            std::string sql = prefix_;
+            if (style_ == batch_insert_style::unnest) {
+                auto types = unnest_types();
+                sql += " SELECT * FROM unnest(";
+                for (std::size_t col = 0; col < column_count; ++col) {
+                    sql += std::format("{}${}::{}[]", col ? ", " : "", col + 1, types[col]);
+                }
+                sql += ")";
+                return sql;
+            }
+
+            sql += " VALUES ";
+            std::size_t param = 1;
+            for (std::size_t row = 0; row < rows; ++row) {
+                sql += row ? ", (" : "(";
+                for (std::size_t col = 0; col < column_count; ++col) {
+                    sql += std::format("{}${}", col ? ", " : "", param++);
+                }
+                sql += ")";
+            }
+            return sql;
+        }
+
+        // Insert every row; returns the total number of rows inserted
+        std::size_t execute() {
+            const std::size_t per_chunk = rows_per_chunk();
+            const std::string full_sql = chunk_sql(per_chunk);
+            const std::vector<Oid> full_types = chunk_param_types(per_chunk);
+            const std::string full_name = detail::statement_name(full_sql, full_types);
+
+            std::optional<database_pipeline> pipeline;
+            if (pipelined_) {
+                pipeline.emplace(*conn_);
+            }
+
+            std::size_t inserted = 0;
+            bool full_prepare_queued = false;
+            chunk_buffer chunk;
+            chunk.reset(per_chunk);
+
+            auto flush = [&] {
+                if (chunk.rows == 0) return;
+                chunk.finish(style_);
+
+                // unnest SQL does not depend on the row count, so every chunk reuses it
+                const bool full = chunk.rows == per_chunk || style_ == batch_insert_style::unnest;
+                if (full && !conn_->is_prepared(full_name) && !full_prepare_queued) {
+                    if (pipeline) {
+                        pipeline->send_prepare(full_name, full_sql, full_types);
+                        full_prepare_queued = true;
+                    } else {
+                        conn_->prepare(full_name, full_sql, full_types);
+                    }
+                }
+
+                const int count = static_cast<int>(chunk.values.size());
+                if (full) {
+                    if (pipeline) {
+                        pipeline->send_prepared_raw(full_name, count, chunk.values.data(),
+                                                    chunk.lengths.data(), chunk.formats.data());
+                    } else {
+                        query_result result(conn_->execute_prepared_raw(
+                            full_name, count, chunk.values.data(),
+                            chunk.lengths.data(), chunk.formats.data()));
+                        inserted += result.affected_rows();
+                    }
+                } else {
+                    const std::string sql = chunk_sql(chunk.rows);
+                    const std::vector<Oid> types = chunk_param_types(chunk.rows);
+                    if (pipeline) {
+                        pipeline->send_raw(sql, count, types.data(), chunk.values.data(),
+                                           chunk.lengths.data(), chunk.formats.data());
+                    } else {
+                        query_result result(conn_->execute_params_raw(
+                            sql, count, types.data(), chunk.values.data(),
+                            chunk.lengths.data(), chunk.formats.data()));
+                        inserted += result.affected_rows();
+                    }
+                }
+                chunk.reset(per_chunk);
+            };
+
+            for (auto&& item : rows_) {
+                auto&& row = std::invoke(proj_, item);
+                append_row(chunk, row, std::make_index_sequence<column_count>{});
+                if (++chunk.rows == per_chunk) {
+                    flush();
+                }
+            }
+            flush();
+
+            if (pipeline) {
+                for (const auto& result : pipeline->sync()) {
+                    inserted += result.affected_rows();
+                }
+            }
+            return inserted;
+        }
+
+    private:
+        template<std::size_t I>
+        using column_t = std::remove_cvref_t<std::tuple_element_t<I, row_type>>;
+
+        // Encoded parameters for the chunk being assembled
+        struct chunk_buffer {
+            std::size_t rows = 0;
+            std::vector<detail::encoded_param> params;   // VALUES style
+            std::vector<std::string> arrays;             // unnest style, one per column
+            std::vector<const char*> values;
+            std::vector<int> lengths;
+            std::vector<int> formats;
+
+            void reset(std::size_t capacity) {
+                rows = 0;
+                params.clear();
+                params.reserve(capacity * column_count);
+                arrays.assign(column_count, std::string{});
+                values.clear();
+                lengths.clear();
+                formats.clear();
+            }
+
+            void finish(batch_insert_style style) {
+                if (style == batch_insert_style::unnest) {
+                    for (auto& array : arrays) {
+                        array.insert(array.begin(), '{');
+                        array += '}';
+                        values.push_back(array.c_str());
+                        lengths.push_back(0);
+                        formats.push_back(0);
+                    }
+                    return;
+                }
+                for (const auto& param : params) {
+                    values.push_back(param.value);
+                    lengths.push_back(param.length);
+                    formats.push_back(param.format);
+                }
+            }
+        };
+
+        template<typename Row, std::size_t... I>
+        void append_row(chunk_buffer& chunk, const Row& row, std::index_sequence<I...>) const {
+            if (style_ == batch_insert_style::unnest) {
+                (append_array_value(chunk.arrays[I], chunk.rows, std::get<I>(row)), ...);
+            } else {
+                (append_param(chunk, std::get<I>(row)), ...);
+            }
+        }
+
+        template<typename T>
+        static void append_param(chunk_buffer& chunk, const T& value) {
+            auto& slot = chunk.params.emplace_back();
+            detail::encode_param(value, slot);
+            // Rows may be temporaries, so text values are copied into the slot
+            if (slot.value && slot.format == 0 && slot.value != slot.text.c_str()) {
+                slot.text = slot.value;
+                slot.value = slot.text.c_str();
+            }
+        }
+
+        template<typename T>
+        static void append_array_value(std::string& array, std::size_t row, const T& value) {
+            if (row > 0) {
+                array += ',';
+            }
+            detail::append_array_element(array, value);
+        }
+
+        [[nodiscard]] std::vector<std::string> unnest_types() const {
+            if (!column_types_.empty()) {
+                if (column_types_.size() != column_count) {
+                    throw database_error{std::format(
+                        "column_types has {} entries but rows have {} columns",
+                        column_types_.size(), column_count)};
+                }
+                return column_types_;
+            }
+            return [&]<std::size_t... I>(std::index_sequence<I...>) {
+                return std::vector<std::string>{
+                    std::string(detail::param_type_name<column_t<I>>())...};
+            }(std::make_index_sequence<column_count>{});
+        }
+
+        [[nodiscard]] std::vector<Oid> chunk_param_types(std::size_t rows) const {
+            if (style_ == batch_insert_style::unnest) {
+                return {};  // element types come from the casts in the SQL
+            }
+            const std::array<Oid, column_count> row_types = [&]<std::size_t... I>(
+                std::index_sequence<I...>) {
+                return std::array<Oid, column_count>{detail::param_oid<column_t<I>>()...};
+            }(std::make_index_sequence<column_count>{});
+
+            std::vector<Oid> types;
+            types.reserve(rows * column_count);
+            for (std::size_t row = 0; row < rows; ++row) {
+                types.insert(types.end(), row_types.begin(), row_types.end());
+            }
+            return types;
+        }
+
+        std::shared_ptr<database_connection> owner_;  // keeps shared connections alive
+        database_connection* conn_;
+        std::string prefix_;
+        Rows rows_;
+        Proj proj_;
+        std::size_t chunk_rows_ = 1000;
+        batch_insert_style style_ = batch_insert_style::values;
+        std::vector<std::string> column_types_;
+        bool pipelined_ = false;
+    };
+
+    // ============================================================================
+    // Keyset Pagination
+    // ============================================================================
+
+    // Pages through a SELECT with WHERE (k1, k2) > (last k1, last k2)
+    // ORDER BY k1, k2 LIMIT n, so every page costs the same regardless of depth.
+    // Obtained from typed_query_builder::keyset_paginate(). Key columns must be
+    // selected, non-null and together unique. Both page statements are prepared
+    // once per connection.
+    class keyset_paginator {
+    public:
+        keyset_paginator(std::shared_ptr<database_connection> owner, database_connection& conn,
+                         std::string base_sql, bool has_where,
+                         std::vector<std::string> key_columns, int page_size, bool ascending)
+            : owner_(std::move(owner)), conn_(&conn),
+              key_columns_(std::move(key_columns)), page_size_(page_size) {
+            
+            if (key_columns_.empty()) {
+                throw database_error{"keyset_paginate requires at least one key column"};
+            }
+            if (page_size_ <= 0) {
+                throw database_error{"keyset_paginate requires a positive page size"};
+            }
+
+            std::string order = " ORDER BY ";
+            std::string keys;
+            for (std::size_t i = 0; i < key_columns_.size(); ++i) {
+                order += std::format("{}{} {}", i ? ", " : "", key_columns_[i],
+                                     ascending ? "ASC" : "DESC");
+                keys += std::format("{}{}", i ? ", " : "", key_columns_[i]);
+            }
+            const std::string limit = std::format(" LIMIT {}", page_size_);
+
+            base_sql_ = std::move(base_sql);
+            has_where_ = has_where;
+            ascending_ = ascending;
+            order_limit_ = order + limit;
+            key_list_ = keys;
+        }
+
+        // Bind parameters referenced by the base query's WHERE clause ($1..$n)
+        template<typename... Args>
+        keyset_paginator& with_params(const Args&... args) {
+            base_params_.clear();
+            base_params_.reserve(sizeof...(Args));
+            base_types_.clear();
+            (bind_param(args), ...);
+            return *this;
+        }
+
+        // Continue after a previously returned key (e.g. an API cursor);
+        // values are in key column order, as text
+        keyset_paginator& resume_after(std::vector<std::optional<std::string>> key) {
+            if (key.size() != key_columns_.size()) {
+                throw database_error{std::format(
+                    "resume_after expects {} key values, got {}", key_columns_.size(), key.size())};
+            }
+            last_key_ = std::move(key);
+            done_ = false;
+            return *this;
+        }
+
+        // Fetch the next page; std::nullopt once the table is exhausted
+        [[nodiscard]] std::optional<query_result> next_page() {
+            if (done_) return std::nullopt;
+            const std::string sql = last_key_.empty() ? first_sql() : next_sql();
+            const std::vector<Oid> types = param_types();
+            const std::string name = detail::statement_name(sql, types);
+            if (!conn_->is_prepared(name)) {
+                conn_->prepare(name, sql, types);
+            }
+            auto params = page_params();
+            return accept(query_result(conn_->execute_prepared_raw(
+                name, static_cast<int>(params.values.size()), params.values.data(),
+                params.lengths.data(), params.formats.data())));
+        }
+
+        // Async variant of next_page() (connection must have an io_context)
+        [[nodiscard]] net::awaitable<std::optional<query_result>> async_next_page() {
+            if (done_) co_return std::nullopt;
+            const std::string sql = last_key_.empty() ? first_sql() : next_sql();
+            const std::vector<Oid> types = param_types();
+            const std::string name = detail::statement_name(sql, types);
+            if (!conn_->is_prepared(name)) {
+                co_await conn_->async_prepare(name, sql, types);
+            }
+            auto params = page_params();
+            co_return accept(co_await conn_->async_execute_prepared_raw(
+                name, static_cast<int>(params.values.size()), params.values.data(),
+                params.lengths.data(), params.formats.data()));
+        }
+
+        // Key of the last row returned so far (empty before the first page)
+        [[nodiscard]] const std::vector<std::optional<std::string>>& last_key() const noexcept {
+            return last_key_;
+        }
+
+        [[nodiscard]] bool done() const noexcept { return done_; }
+
+        [[nodiscard]] int page_size() const noexcept { return page_size_; }
+
+        // SQL of the first page and of every following page
+        [[nodiscard]] std::string first_sql() const {
+            return base_sql_ + order_limit_;
+        }
+
+        [[nodiscard]] std::string next_sql() const {
+            std::string placeholders;
+            for (std::size_t i = 0; i < key_columns_.size(); ++i) {
+                placeholders += std::format("{}${}", i ? ", " : "", base_params_.size() + i + 1);
+            }
+            // where() parenthesizes its conditions, so the key predicate ANDs
+            // with the whole base WHERE clause
+            return std::format("{}{}({}) {} ({}){}", base_sql_, has_where_ ? " AND " : " WHERE ",
+                               key_list_, ascending_ ? ">" : "<", placeholders, order_limit_);
+        }
+
+        // Input range over pages: for (const auto& page : paginator) { ... }
+        class page_iterator {
+        public:
+            using value_type = query_result;
+            using difference_type = std::ptrdiff_t;
+
+            page_iterator() = default;
+            page_iterator(keyset_paginator* pager, std::optional<query_result> page)
+                : pager_(pager), page_(std::move(page)) {}
+
+            const query_result& operator*() const { return *page_; }
+            const query_result* operator->() const { return &*page_; }
+
+            page_iterator& operator++() {
+                page_ = pager_->next_page();
+                return *this;
+            }
+
+            void operator++(int) { ++*this; }
+
+            bool operator==(std::default_sentinel_t) const noexcept { return !page_; }
+
+        private:
+            keyset_paginator* pager_ = nullptr;
+            std::optional<query_result> page_;
+        };
+
+        [[nodiscard]] page_iterator begin() { return page_iterator(this, next_page()); }
+        [[nodiscard]] std::default_sentinel_t end() const noexcept { return {}; }
+
+    private:
+        struct param_arrays {
+            std::vector<const char*> values;
+            std::vector<int> lengths;
+            std::vector<int> formats;
+        };
+
+        // An encoded base parameter, owning its bytes; the pointers handed to
+        // libpq are taken in page_params(), so copies of the paginator stay valid
+        struct bound_param {
+            std::optional<std::string> bytes;  // std::nullopt is SQL NULL
+            int format = 0;
+        };
+
+        template<typename T>
+        void bind_param(const T& value) {
+            base_types_.push_back(detail::param_oid<T>());
+            detail::encoded_param slot;
+            detail::encode_param(value, slot);
+            auto& bound = base_params_.emplace_back();
+            bound.format = slot.format;
+            if (slot.value) {
+                bound.bytes = slot.format == 1 ? std::string(slot.value, static_cast<std::size_t>(slot.length))
+                                               : std::string(slot.value);
+            }
+        }
+
+        // Binary base parameters need declared types; key values are typed by the server
+        [[nodiscard]] std::vector<Oid> param_types() const {
+            std::vector<Oid> types = base_types_;
+            if (!last_key_.empty()) {
+                types.resize(types.size() + key_columns_.size(), 0);
+            }
+            return types;
+        }
+
+        [[nodiscard]] param_arrays page_params() const {
+            param_arrays params;
+            for (const auto& param : base_params_) {
+                params.values.push_back(param.bytes ? param.bytes->data() : nullptr);
+                params.lengths.push_back(param.bytes ? static_cast<int>(param.bytes->size()) : 0);
+                params.formats.push_back(param.format);
+            }
+            for (const auto& key : last_key_) {
+                params.values.push_back(key ? key->c_str() : nullptr);
+                params.lengths.push_back(0);
+                params.formats.push_back(0);
+            }
+            return params;
+        }
+
+        std::optional<query_result> accept(query_result page) {
+            if (page.row_count() < page_size_) {
+                done_ = true;
+            }
+            if (page.row_count() == 0) {
+                return std::nullopt;
+            }
+
+            if (key_indexes_.empty()) {
+                for (const auto& column : key_columns_) {
+                    // Qualified keys (u.id) appear unqualified in the result
+                    auto dot = column.rfind('.');
+                    auto name = dot == std::string::npos ? column : column.substr(dot + 1);
+                    auto index = page.column_index(name);
+                    if (!index) {
+                        throw database_error{std::format(
+                            "Keyset column '{}' must be part of the select list", column)};
+                    }
+                    key_indexes_.push_back(*index);
+                }
+            }
+
+            const int last_row = page.row_count() - 1;
+            last_key_.clear();
+            for (int index : key_indexes_) {
+                auto value = page.get_value(last_row, index);
+                last_key_.push_back(value ? std::optional<std::string>(*value) : std::nullopt);
+            }
+            return page;
+        }
+
+        std::shared_ptr<database_connection> owner_;  // keeps shared connections alive
+        database_connection* conn_;
+        std::vector<std::string> key_columns_;
+        int page_size_;
+        std::string base_sql_;
+        bool has_where_ = false;
+        bool ascending_ = true;
+        std::string order_limit_;
+        std::string key_list_;
+        std::vector<bound_param> base_params_;
+        std::vector<Oid> base_types_;
+        std::vector<int> key_indexes_;
+        std::vector<std::optional<std::string>> last_key_;
+        bool done_ = false;
+    };
+
     // ============================================================================
     // Type-Safe Query Builder with Compile-Time Validation
     // Safe version that can work with both references and shared pointers
@@ -403,6 +1375,15 @@ namespace fenrir {
             );
         }
 
+        // Batched VALUES from a range of tuple-like rows (or any rows with a
+        // projection to a tuple, e.g. [](const user& u) { return std::tie(u.name, u.age); })
+        template<std::ranges::input_range R, typename Proj = std::identity>
+        [[nodiscard]] auto values_range(R&& rows, Proj proj = {}) requires CanAddValues<State> {
+            return batch_insert<std::views::all_t<R>, Proj>(
+                conn_ptr_, get_connection(), query_,
+                std::views::all(std::forward<R>(rows)), std::move(proj));
+        }
+
         // ========================================================================
         // WHERE clause (can be added multiple times as AND conditions)
         // ========================================================================
@@ -410,14 +1391,15 @@ namespace fenrir {
         [[nodiscard]] auto where(std::string_view condition) 
             requires (QueryStarted<State> && HasFrom<State>) {
             using new_state = query_state<typename State::query_type, State::has_from,
-                                         true, State::has_set, State::has_values>;
+                                         true, State::has_set, State::has_values, State::has_tail>;
             std::string new_query = query_;
             if (!State::has_where) {
                 new_query += " WHERE ";
             } else {
                 new_query += " AND ";
             }
-            new_query += condition;
+            // Parenthesized so an OR inside one condition cannot escape the ANDs
+            new_query += std::format("({})", condition);
             if (conn_ptr_) {
                 return typed_query_builder<new_state>(conn_ptr_, std::move(new_query));
             }
@@ -431,12 +1413,12 @@ namespace fenrir {
         [[nodiscard]] auto order_by(std::string_view column, bool ascending = true)
             requires (SelectQuery<State> && HasFrom<State>) {
             if (conn_ptr_) {
-                return typed_query_builder<State>(
+                return typed_query_builder<with_tail<State>>(
                     conn_ptr_,
                     query_ + std::format(" ORDER BY {} {}", column, ascending ? "ASC" : "DESC")
                 );
             }
-            return typed_query_builder<State>(
+            return typed_query_builder<with_tail<State>>(
                 *conn_ref_,
                 query_ + std::format(" ORDER BY {} {}", column, ascending ? "ASC" : "DESC")
             );
@@ -448,12 +1430,12 @@ namespace fenrir {
         
         [[nodiscard]] auto limit(int count) requires (SelectQuery<State> && HasFrom<State>) {
             if (conn_ptr_) {
-                return typed_query_builder<State>(
+                return typed_query_builder<with_tail<State>>(
                     conn_ptr_,
                     query_ + std::format(" LIMIT {}", count)
                 );
             }
-            return typed_query_builder<State>(
+            return typed_query_builder<with_tail<State>>(
                 *conn_ref_,
                 query_ + std::format(" LIMIT {}", count)
             );
@@ -461,17 +1443,30 @@ namespace fenrir {
         
         [[nodiscard]] auto offset(int count) requires (SelectQuery<State> && HasFrom<State>) {
             if (conn_ptr_) {
-                return typed_query_builder<State>(
+                return typed_query_builder<with_tail<State>>(
                     conn_ptr_,
                     query_ + std::format(" OFFSET {}", count)
                 );
             }
-            return typed_query_builder<State>(
+            return typed_query_builder<with_tail<State>>(
                 *conn_ref_,
                 query_ + std::format(" OFFSET {}", count)
             );
         }
         
+        // ========================================================================
+        // Keyset pagination (SELECT only, instead of ORDER BY/LIMIT/OFFSET)
+        // ========================================================================
+        
+        // Not after order_by(), limit() or offset(): the paginator supplies its own.
+        // Nor after group_by() or having(): the key predicate would follow them.
+        [[nodiscard]] keyset_paginator keyset_paginate(std::vector<std::string> key_columns,
+                                                       int page_size, bool ascending = true)
+            requires (SelectQuery<State> && HasFrom<State> && !State::has_tail) {
+            return keyset_paginator(conn_ptr_, get_connection(), query_, State::has_where,
+                                    std::move(key_columns), page_size, ascending);
+        }
+        
         // ========================================================================
         // JOIN (SELECT only, after FROM)
         // ========================================================================
@@ -518,12 +1513,12 @@ namespace fenrir {
         [[nodiscard]] auto group_by(std::string_view columns)
             requires (SelectQuery<State> && HasFrom<State>) {
             if (conn_ptr_) {
-                return typed_query_builder<State>(
+                return typed_query_builder<with_tail<State>>(
                     conn_ptr_,
                     query_ + std::format(" GROUP BY {}", columns)
                 );
             }
-            return typed_query_builder<State>(
+            return typed_query_builder<with_tail<State>>(
                 *conn_ref_,
                 query_ + std::format(" GROUP BY {}", columns)
             );
@@ -532,12 +1527,12 @@ namespace fenrir {
         [[nodiscard]] auto having(std::string_view condition)
             requires (SelectQuery<State> && HasFrom<State>) {
             if (conn_ptr_) {
-                return typed_query_builder<State>(
+                return typed_query_builder<with_tail<State>>(
                     conn_ptr_,
                     query_ + std::format(" HAVING {}", condition)
                 );
             }
-            return typed_query_builder<State>(
+            return typed_query_builder<with_tail<State>>(
                 *conn_ref_,
                 query_ + std::format(" HAVING {}", condition)
             );
@@ -585,6 +1580,44 @@ namespace fenrir {
             co_return co_await conn.async_execute_params(query_, std::forward<Args>(args)...);
         }
         
+        // ========================================================================
+        // Prepared statements (server-side plan, typed arguments)
+        // ========================================================================
+        
+        // Prepare on the builder's connection
+        template<typename... Args>
+        [[nodiscard]] prepared_statement<Args...> prepare() requires CanExecute<State> {
+            return prepare<Args...>(get_connection());
+        }
+        
+        // Prepare on a specific connection
+        template<typename... Args>
+        [[nodiscard]] prepared_statement<Args...> prepare(database_connection& conn) const
+            requires CanExecute<State> {
+            return prepared_statement<Args...>(detail::describe_statement<Args...>(conn, query_), conn);
+        }
+        
+        // Prepare for a connection pool (described once, prepared lazily per connection)
+        // The pool must outlive the returned statement.
+        template<typename... Args, typename Pool>
+        requires requires(Pool& p) { *p.acquire(); p.async_acquire(); }
+        [[nodiscard]] prepared_statement<Args...> prepare(Pool& pool) const
+            requires CanExecute<State> {
+            auto conn = pool.acquire();
+            return prepared_statement<Args...>(detail::describe_statement<Args...>(*conn, query_), pool);
+        }
+        
+        // ========================================================================
+        // Plan inspection
+        // ========================================================================
+        
+        // EXPLAIN the built query (see fenrir::explain for options)
+        template<typename... Args>
+        [[nodiscard]] query_plan explain(const explain_options& options = {}, Args&&... args)
+            requires CanExecute<State> {
+            return fenrir::explain(get_connection(), query_, options, std::forward<Args>(args)...);
+        }
+        
         // ========================================================================
         // Direct SQL (bypass builder validation)
         // ========================================================================
@@ -790,6 +1823,12 @@ namespace fenrir {
             co_return result;
         }
 
+        // EXPLAIN the built query (see fenrir::explain for options)
+        template<typename... Args>
+        [[nodiscard]] query_plan explain(const explain_options& options = {}, Args&&... args) {
+            return fenrir::explain(get_connection(), query_, options, std::forward<Args>(args)...);
+        }
+
         // Direct SQL execution
         [[nodiscard]] query_result raw(std::string_view sql) {
             auto& conn = get_connection();
@@ -843,4 +1882,7 @@ namespace fenrir {
         std::string query_;
     };
 
-} // namespace fenrir
\ No newline at end of file
+} // namespace fenrir
+
+// Definition of fenrir::explain, which the builders' explain() call
+#include "database_explain.hpp"
@@ -0,0 +1,503 @@
+#pragma once
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <variant>
+#include <vector>
+#include <format>
+#include "database_error.hpp"
+
+namespace fenrir {
+
+    // ============================================================================
+    // EXPLAIN Capture
+    // ============================================================================
+
+    // Options for EXPLAIN (FORMAT JSON is always used)
+    struct explain_options {
+        bool analyze = true;     // Execute the statement and record actual timings
+        bool buffers = true;     // Record shared/temp buffer usage
+        bool verbose = false;    // Output column lists and schema-qualified names
+        bool settings = false;   // Include planner settings that differ from defaults
+        bool rollback = true;    // With analyze, undo the statement's effects (BEGIN/ROLLBACK or a savepoint)
+    };
+
+    // Buffer usage of one plan node (block counts, BUFFERS option)
+    struct plan_buffers {
+        long long shared_hit = 0;
+        long long shared_read = 0;
+        long long shared_dirtied = 0;
+        long long shared_written = 0;
+        long long temp_read = 0;
+        long long temp_written = 0;
+    };
+
+    // One node of an execution plan
+    struct plan_node {
+        std::string node_type;                   // "Seq Scan", "Index Scan", "Hash Join", ...
+        std::optional<std::string> relation_name;
+        std::optional<std::string> alias;
+        std::optional<std::string> index_name;
+        std::optional<std::string> join_type;
+
+        // Planner estimates
+        double startup_cost = 0.0;
+        double total_cost = 0.0;
+        double plan_rows = 0.0;
+        int plan_width = 0;
+
+        // Measured values (ANALYZE only); times are per loop, in milliseconds
+        std::optional<double> actual_startup_time;
+        std::optional<double> actual_total_time;
+        std::optional<double> actual_rows;
+        std::optional<double> actual_loops;
+
+        plan_buffers buffers;
+
+        // Every other scalar attribute as text ("Filter", "Index Cond", ...)
+        std::vector<std::pair<std::string, std::string>> properties;
+
+        std::vector<plan_node> children;
+
+        [[nodiscard]] std::optional<std::string_view> property(std::string_view key) const {
+            for (const auto& [name, value] : properties) {
+                if (name == key) return value;
+            }
+            return std::nullopt;
+        }
+
+        // Depth-first, parents before children
+        void visit(const std::function<void(const plan_node&, int depth)>& fn, int depth = 0) const {
+            fn(*this, depth);
+            for (const auto& child : children) {
+                child.visit(fn, depth + 1);
+            }
+        }
+    };
+
+    // Plan shape and cost bounds checked by query_plan::violations()
+    struct plan_expectation {
+        std::vector<std::string> uses_indexes;       // Each index must appear in the plan
+        std::vector<std::string> no_seq_scan_on;     // No Seq Scan on these relations ("*" = any)
+        std::optional<double> max_total_cost;        // Upper bound on the root's estimated cost
+        std::optional<double> max_estimated_rows;    // Upper bound on the root's row estimate
+        std::optional<double> max_execution_time;    // Upper bound in milliseconds (ANALYZE only)
+    };
+
+    namespace detail {
+
+        // Minimal JSON reader for EXPLAIN (FORMAT JSON) output
+        struct json_value {
+            using array = std::vector<json_value>;
+            using object = std::vector<std::pair<std::string, json_value>>;
+
+            std::variant<std::nullptr_t, bool, double, std::string, array, object> data;
+
+            [[nodiscard]] const json_value* find(std::string_view key) const {
+                if (auto* members = std::get_if<object>(&data)) {
+                    for (const auto& [name, value] : *members) {
+                        if (name == key) return &value;
+                    }
+                }
+                return nullptr;
+            }
+        };
+
+        class json_reader {
+        public:
+            explicit json_reader(std::string_view text) : text_(text) {}
+
+            [[nodiscard]] json_value parse() {
+                json_value value = parse_value();
+                skip_whitespace();
+                if (pos_ != text_.size()) fail("trailing characters");
+                return value;
+            }
+
+        private:
+            [[noreturn]] void fail(std::string_view what) const {
+                throw database_error{std::format("Invalid EXPLAIN output: {} at offset {}", what, pos_)};
+            }
+
+            void skip_whitespace() {
+                while (pos_ < text_.size() &&
+                       (text_[pos_] == ' ' || text_[pos_] == '\n' || text_[pos_] == '\r' || text_[pos_] == '\t')) {
+                    ++pos_;
+                }
+            }
+
+            void expect(char c) {
+                skip_whitespace();
+                if (pos_ >= text_.size() || text_[pos_] != c) fail(std::format("expected '{}'", c));
+                ++pos_;
+            }
+
+            bool consume_literal(std::string_view literal) {
+                if (text_.substr(pos_, literal.size()) != literal) return false;
+                pos_ += literal.size();
+                return true;
+            }
+
+            json_value parse_value() {
+                skip_whitespace();
+                if (pos_ >= text_.size()) fail("unexpected end of input");
+
+                char c = text_[pos_];
+                if (c == '{') return parse_object();
+                if (c == '[') return parse_array();
+                if (c == '"') return json_value{parse_string()};
+                if (consume_literal("true")) return json_value{true};
+                if (consume_literal("false")) return json_value{false};
+                if (consume_literal("null")) return json_value{nullptr};
+                return parse_number();
+            }
+
+            json_value parse_object() {
+                json_value::object members;
+                expect('{');
+                skip_whitespace();
+                if (pos_ < text_.size() && text_[pos_] == '}') {
+                    ++pos_;
+                    return json_value{std::move(members)};
+                }
+                while (true) {
+                    skip_whitespace();
+                    std::string key = parse_string();
+                    expect(':');
+                    members.emplace_back(std::move(key), parse_value());
+                    skip_whitespace();
+                    if (pos_ < text_.size() && text_[pos_] == ',') {
+                        ++pos_;
+                        continue;
+                    }
+                    expect('}');
+                    return json_value{std::move(members)};
+                }
+            }
+
+            json_value parse_array() {
+                json_value::array elements;
+                expect('[');
+                skip_whitespace();
+                if (pos_ < text_.size() && text_[pos_] == ']') {
+                    ++pos_;
+                    return json_value{std::move(elements)};
+                }
+                while (true) {
+                    elements.push_back(parse_value());
+                    skip_whitespace();
+                    if (pos_ < text_.size() && text_[pos_] == ',') {
+                        ++pos_;
+                        continue;
+                    }
+                    expect(']');
+                    return json_value{std::move(elements)};
+                }
+            }
+
+            std::string parse_string() {
+                if (pos_ >= text_.size() || text_[pos_] != '"') fail("expected string");
+                ++pos_;
+
+                std::string out;
+                while (pos_ < text_.size() && text_[pos_] != '"') {
+                    char c = text_[pos_++];
+                    if (c != '\\') {
+                        out += c;
+                        continue;
+                    }
+                    if (pos_ >= text_.size()) break;
+                    char escaped = text_[pos_++];
+                    switch (escaped) {
+                        case 'n': out += '\n'; break;
+                        case 't': out += '\t'; break;
+                        case 'r': out += '\r'; break;
+                        case 'b': out += '\b'; break;
+                        case 'f': out += '\f'; break;
+                        case 'u': {
+                            unsigned code = 0;
+                            auto [ptr, ec] = std::from_chars(text_.data() + pos_,
+                                                             text_.data() + std::min(pos_ + 4, text_.size()),
+                                                             code, 16);
+                            if (ec != std::errc{} || ptr != text_.data() + pos_ + 4) fail("bad \\u escape");
+                            pos_ += 4;
+                            // Characters outside the BMP come as a surrogate pair
+                            if (code >= 0xD800 && code < 0xDC00) {
+                                unsigned low = 0;
+                                if (text_.substr(pos_, 2) == "\\u") {
+                                    auto [low_ptr, low_ec] = std::from_chars(
+                                        text_.data() + pos_ + 2,
+                                        text_.data() + std::min(pos_ + 6, text_.size()), low, 16);
+                                    if (low_ec != std::errc{} || low_ptr != text_.data() + pos_ + 6) {
+                                        fail("bad \\u escape");
+                                    }
+                                }
+                                if (low < 0xDC00 || low >= 0xE000) fail("unpaired surrogate in \\u escape");
+                                pos_ += 6;
+                                code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                            } else if (code >= 0xDC00 && code < 0xE000) {
+                                fail("unpaired surrogate in \\u escape");
+                            }
+                            append_utf8(out, code);
+                            break;
+                        }
+                        default: out += escaped; break;
+                    }
+                }
+                if (pos_ >= text_.size()) fail("unterminated string");
+                ++pos_;
+                return out;
+            }
+
+            static void append_utf8(std::string& out, unsigned code) {
+                if (code < 0x80) {
+                    out += static_cast<char>(code);
+                } else if (code < 0x800) {
+                    out += static_cast<char>(0xC0 | (code >> 6));
+                    out += static_cast<char>(0x80 | (code & 0x3F));
+                } else if (code < 0x10000) {
+                    out += static_cast<char>(0xE0 | (code >> 12));
+                    out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+                    out += static_cast<char>(0x80 | (code & 0x3F));
+                } else {
+                    out += static_cast<char>(0xF0 | (code >> 18));
+                    out += static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+                    out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+                    out += static_cast<char>(0x80 | (code & 0x3F));
+                }
+            }
+
+            json_value parse_number() {
+                std::size_t start = pos_;
+                while (pos_ < text_.size() &&
+                       (std::isdigit(static_cast<unsigned char>(text_[pos_])) || text_[pos_] == '-' ||
+                        text_[pos_] == '+' || text_[pos_] == '.' || text_[pos_] == 'e' || text_[pos_] == 'E')) {
+                    ++pos_;
+                }
+                double value = 0.0;
+                auto [ptr, ec] = std::from_chars(text_.data() + start, text_.data() + pos_, value);
+                if (start == pos_ || ec != std::errc{} || ptr != text_.data() + pos_) fail("bad value");
+                return json_value{value};
+            }
+
+            std::string_view text_;
+            std::size_t pos_ = 0;
+        };
+
+        [[nodiscard]] inline std::string json_scalar_text(const json_value& value) {
+            if (auto* s = std::get_if<std::string>(&value.data)) return *s;
+            if (auto* d = std::get_if<double>(&value.data)) return std::format("{}", *d);
+            if (auto* b = std::get_if<bool>(&value.data)) return *b ? "true" : "false";
+            return "null";
+        }
+
+        [[nodiscard]] inline plan_node to_plan_node(const json_value& json) {
+            const auto* members = std::get_if<json_value::object>(&json.data);
+            if (!members) throw database_error{"Invalid EXPLAIN output: plan node is not an object"};
+
+            plan_node node;
+            for (const auto& [key, value] : *members) {
+                const double* number = std::get_if<double>(&value.data);
+                const std::string* text = std::get_if<std::string>(&value.data);
+
+                if (key == "Plans") {
+                    if (auto* children = std::get_if<json_value::array>(&value.data)) {
+                        for (const auto& child : *children) {
+                            node.children.push_back(to_plan_node(child));
+                        }
+                    }
+                } else if (key == "Node Type" && text) node.node_type = *text;
+                else if (key == "Relation Name" && text) node.relation_name = *text;
+                else if (key == "Alias" && text) node.alias = *text;
+                else if (key == "Index Name" && text) node.index_name = *text;
+                else if (key == "Join Type" && text) node.join_type = *text;
+                else if (key == "Startup Cost" && number) node.startup_cost = *number;
+                else if (key == "Total Cost" && number) node.total_cost = *number;
+                else if (key == "Plan Rows" && number) node.plan_rows = *number;
+                else if (key == "Plan Width" && number) node.plan_width = static_cast<int>(*number);
+                else if (key == "Actual Startup Time" && number) node.actual_startup_time = *number;
+                else if (key == "Actual Total Time" && number) node.actual_total_time = *number;
+                else if (key == "Actual Rows" && number) node.actual_rows = *number;
+                else if (key == "Actual Loops" && number) node.actual_loops = *number;
+                else if (key == "Shared Hit Blocks" && number) node.buffers.shared_hit = static_cast<long long>(*number);
+                else if (key == "Shared Read Blocks" && number) node.buffers.shared_read = static_cast<long long>(*number);
+                else if (key == "Shared Dirtied Blocks" && number) node.buffers.shared_dirtied = static_cast<long long>(*number);
+                else if (key == "Shared Written Blocks" && number) node.buffers.shared_written = static_cast<long long>(*number);
+                else if (key == "Temp Read Blocks" && number) node.buffers.temp_read = static_cast<long long>(*number);
+                else if (key == "Temp Written Blocks" && number) node.buffers.temp_written = static_cast<long long>(*number);
+                else if (!std::holds_alternative<json_value::array>(value.data) &&
+                         !std::holds_alternative<json_value::object>(value.data)) {
+                    node.properties.emplace_back(key, json_scalar_text(value));
+                }
+            }
+            return node;
+        }
+
+    } // namespace detail
+
+    // Parsed EXPLAIN (FORMAT JSON) output
+    class query_plan {
+    public:
+        // Parse the JSON document returned by EXPLAIN (FORMAT JSON)
+        [[nodiscard]] static query_plan parse(std::string json) {
+            detail::json_value document = detail::json_reader(json).parse();
+
+            // The document is a one-element array wrapping the top-level object
+            const detail::json_value* top = &document;
+            if (auto* elements = std::get_if<detail::json_value::array>(&document.data)) {
+                if (elements->empty()) throw database_error{"Invalid EXPLAIN output: empty document"};
+                top = &elements->front();
+            }
+
+            const detail::json_value* plan = top->find("Plan");
+            if (!plan) throw database_error{"Invalid EXPLAIN output: missing \"Plan\""};
+
+            query_plan result;
+            result.root_ = detail::to_plan_node(*plan);
+            if (auto* t = top->find("Planning Time")) {
+                if (auto* ms = std::get_if<double>(&t->data)) result.planning_time_ = *ms;
+            }
+            if (auto* t = top->find("Execution Time")) {
+                if (auto* ms = std::get_if<double>(&t->data)) result.execution_time_ = *ms;
+            }
+            result.json_ = std::move(json);
+            return result;
+        }
+
+        [[nodiscard]] const plan_node& root() const noexcept { return root_; }
+
+        // Milliseconds (planning time needs ANALYZE or SUMMARY, execution time needs ANALYZE)
+        [[nodiscard]] std::optional<double> planning_time() const noexcept { return planning_time_; }
+        [[nodiscard]] std::optional<double> execution_time() const noexcept { return execution_time_; }
+
+        [[nodiscard]] double total_cost() const noexcept { return root_.total_cost; }
+        [[nodiscard]] double estimated_rows() const noexcept { return root_.plan_rows; }
+
+        // Raw server output, for logging or diffing
+        [[nodiscard]] const std::string& json() const noexcept { return json_; }
+
+        // All nodes matching a predicate, in depth-first order
+        [[nodiscard]] std::vector<const plan_node*> find_all(
+            const std::function<bool(const plan_node&)>& predicate) const {
+            std::vector<const plan_node*> matches;
+            root_.visit([&](const plan_node& node, int) {
+                if (predicate(node)) matches.push_back(&node);
+            });
+            return matches;
+        }
+
+        [[nodiscard]] bool uses_index(std::string_view index) const {
+            return !find_all([index](const plan_node& node) {
+                return node.index_name && *node.index_name == index;
+            }).empty();
+        }
+
+        // Sequential scan on relation, or on any relation if none is given
+        [[nodiscard]] bool has_seq_scan(std::string_view relation = {}) const {
+            return !find_all([relation](const plan_node& node) {
+                return node.node_type == "Seq Scan" &&
+                       (relation.empty() || relation == "*" ||
+                        (node.relation_name && *node.relation_name == relation));
+            }).empty();
+        }
+
+        // Human-readable list of unmet expectations (empty if the plan conforms)
+        [[nodiscard]] std::vector<std::string> violations(const plan_expectation& expected) const {
+            std::vector<std::string> problems;
+            for (const auto& index : expected.uses_indexes) {
+                if (!uses_index(index)) {
+                    problems.push_back(std::format("index {} is not used", index));
+                }
+            }
+            for (const auto& relation : expected.no_seq_scan_on) {
+                if (has_seq_scan(relation)) {
+                    problems.push_back(std::format("sequential scan on {}", relation));
+                }
+            }
+            if (expected.max_total_cost && total_cost() > *expected.max_total_cost) {
+                problems.push_back(std::format("estimated cost {:.2f} exceeds {:.2f}",
+                                               total_cost(), *expected.max_total_cost));
+            }
+            if (expected.max_estimated_rows && estimated_rows() > *expected.max_estimated_rows) {
+                problems.push_back(std::format("estimated rows {} exceeds {}",
+                                               estimated_rows(), *expected.max_estimated_rows));
+            }
+            if (expected.max_execution_time) {
+                if (!execution_time_) {
+                    problems.push_back("execution time not available (run with analyze)");
+                } else if (*execution_time_ > *expected.max_execution_time) {
+                    problems.push_back(std::format("execution time {:.3f} ms exceeds {:.3f} ms",
+                                                   *execution_time_, *expected.max_execution_time));
+                }
+            }
+            return problems;
+        }
+
+        // Throw database_error listing every violation together with the plan
+        void require(const plan_expectation& expected) const {
+            auto problems = violations(expected);
+            if (problems.empty()) return;
+
+            std::string message = "Plan regression:";
+            for (const auto& problem : problems) {
+                message += "\n  - " + problem;
+            }
+            message += "\n" + to_string();
+            throw database_error{message};
+        }
+
+        // Indented text rendering similar to psql's EXPLAIN output
+        [[nodiscard]] std::string to_string() const {
+            std::string out;
+            root_.visit([&out](const plan_node& node, int depth) {
+                out += std::string(static_cast<std::size_t>(depth) * 2, ' ');
+                if (depth > 0) out += "->  ";
+                out += node.node_type;
+                if (node.index_name) out += std::format(" using {}", *node.index_name);
+                if (node.relation_name) out += std::format(" on {}", *node.relation_name);
+                out += std::format("  (cost={:.2f}..{:.2f} rows={} width={})",
+                                   node.startup_cost, node.total_cost, node.plan_rows, node.plan_width);
+                if (node.actual_total_time) {
+                    out += std::format(" (actual time={:.3f}..{:.3f} rows={} loops={})",
+                                       node.actual_startup_time.value_or(0.0), *node.actual_total_time,
+                                       node.actual_rows.value_or(0.0), node.actual_loops.value_or(0.0));
+                }
+                out += '\n';
+            });
+            return out;
+        }
+
+    private:
+        plan_node root_;
+        std::optional<double> planning_time_;
+        std::optional<double> execution_time_;
+        std::string json_;
+    };
+
+    namespace detail {
+
+        [[nodiscard]] inline std::string explain_sql(std::string_view sql, const explain_options& options) {
+            std::string flags;
+            if (options.analyze) flags += "ANALYZE, ";
+            if (options.buffers) flags += "BUFFERS, ";
+            if (options.verbose) flags += "VERBOSE, ";
+            if (options.settings) flags += "SETTINGS, ";
+            return std::format("EXPLAIN ({}FORMAT JSON) {}", flags, sql);
+        }
+
+    } // namespace detail
+
+    class database_connection;
+
+    // Defined in database_explain.hpp; declared here for the query builders
+    template<typename... Args>
+    [[nodiscard]] query_plan explain(database_connection& conn, std::string_view sql,
+                                     const explain_options& options = {}, Args&&... args);
+
+} // namespace fenrir
@@ -0,0 +1,138 @@
+#pragma once
+
+#include "database_connection.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <random>
+#include <string_view>
+
+namespace fenrir {
+
+    // Why a failed operation may be worth running again
+    enum class retry_reason {
+        none,                   // Not transient: constraint violations, syntax errors, ...
+        connection_lost,        // SQLSTATE class 08, or the connection died without one
+        serialization_failure,  // 40001
+        deadlock,               // 40P01
+        server_unavailable      // 57P01-57P03 (shutdown, crash recovery), 53300 (too many connections)
+    };
+
+    // Classify an error by its SQLSTATE
+    // connection_ok is whether the connection still works afterwards: errors
+    // raised by libpq itself, such as a dropped socket, carry no SQLSTATE.
+    [[nodiscard]] inline retry_reason classify_error(std::string_view sql_state, bool connection_ok = true) noexcept {
+        if (sql_state == "40001") return retry_reason::serialization_failure;
+        if (sql_state == "40P01") return retry_reason::deadlock;
+        if (sql_state == "57P01" || sql_state == "57P02" || sql_state == "57P03" || sql_state == "53300") {
+            return retry_reason::server_unavailable;
+        }
+        if (sql_state.starts_with("08")) return retry_reason::connection_lost;
+        if (sql_state.empty() && !connection_ok) return retry_reason::connection_lost;
+        return retry_reason::none;
+    }
+
+    [[nodiscard]] inline retry_reason classify_error(const database_error& error, bool connection_ok = true) noexcept {
+        return classify_error(std::string_view{error.sql_state}, connection_ok);
+    }
+
+    // How pooled_connection::execute_with_retry() retries
+    // Only operations marked idempotent are ever run twice: a statement that
+    // failed mid-flight may or may not have been applied.
+    struct retry_policy {
+        bool idempotent = false;                            // The operation may safely run more than once
+        size_t max_attempts = 3;                            // Including the first one
+        std::chrono::milliseconds initial_backoff{20};      // Backoff cap after the first failure...
+        std::chrono::milliseconds max_backoff{1000};        // ...growing by multiplier up to this
+        double multiplier = 2.0;
+        std::chrono::milliseconds deadline{5000};           // Budget for all attempts and backoff (0 = none)
+        bool retry_serialization_failures = true;           // 40001 and 40P01, for statements outside a transaction
+        std::function<void(const database_error&, retry_reason, size_t attempt, std::chrono::milliseconds delay)> on_retry;
+
+        // Policy for an operation that is safe to repeat
+        [[nodiscard]] static retry_policy for_idempotent() {
+            retry_policy policy;
+            policy.idempotent = true;
+            return policy;
+        }
+
+        // Policy of the original execute_with_retry(func, max_retries): up to
+        // max_retries more attempts after a lost connection or unavailable
+        // server, reconnecting at once, whatever the operation
+        [[nodiscard]] static retry_policy reconnect_only(size_t max_retries) {
+            retry_policy policy;
+            policy.idempotent = true;
+            policy.retry_serialization_failures = false;
+            policy.max_attempts = max_retries + 1;
+            policy.initial_backoff = std::chrono::milliseconds{0};
+            policy.max_backoff = std::chrono::milliseconds{0};
+            policy.deadline = std::chrono::milliseconds{0};
+            return policy;
+        }
+
+        [[nodiscard]] bool retries(retry_reason reason) const noexcept {
+            switch (reason) {
+                case retry_reason::none:
+                    return false;
+                case retry_reason::serialization_failure:
+                case retry_reason::deadlock:
+                    return idempotent && retry_serialization_failures;
+                case retry_reason::connection_lost:
+                case retry_reason::server_unavailable:
+                    return idempotent;
+            }
+            return false;
+        }
+    };
+
+    namespace detail {
+
+        // Attempt counter and backoff clock of one retried operation
+        // Backoff is exponential with "equal jitter": half the current cap plus
+        // a uniform share of the other half, so callers that failed together
+        // spread out and none retries immediately.
+        class retry_schedule {
+        public:
+            using clock = std::chrono::steady_clock;
+
+            explicit retry_schedule(const retry_policy& policy)
+                : policy_(policy), start_(clock::now()) {}
+
+            // Delay before the next attempt, or nullopt to give up
+            [[nodiscard]] std::optional<std::chrono::milliseconds> next(retry_reason reason) {
+                if (!policy_.retries(reason) || ++attempts_ >= policy_.max_attempts) return std::nullopt;
+
+                auto cap = std::min<double>(
+                    static_cast<double>(policy_.initial_backoff.count()) *
+                        std::pow(policy_.multiplier, static_cast<double>(attempts_ - 1)),
+                    static_cast<double>(policy_.max_backoff.count()));
+                auto half = static_cast<std::int64_t>(cap / 2);
+                thread_local std::minstd_rand rng{std::random_device{}()};
+                std::uniform_int_distribution<std::int64_t> jitter(0, half);
+                std::chrono::milliseconds delay{half + jitter(rng)};
+
+                if (policy_.deadline.count() > 0 && clock::now() + delay >= start_ + policy_.deadline) {
+                    return std::nullopt;
+                }
+                return delay;
+            }
+
+            [[nodiscard]] size_t attempts() const noexcept { return attempts_; }
+
+            void notify(const database_error& error, retry_reason reason, std::chrono::milliseconds delay) const {
+                if (policy_.on_retry) policy_.on_retry(error, reason, attempts_, delay);
+            }
+
+        private:
+            const retry_policy& policy_;
+            clock::time_point start_;
+            size_t attempts_ = 0;
+        };
+
+    } // namespace detail
+
+} // namespace fenrir
@@ -0,0 +1,256 @@
+#pragma once
+
+#include "database_pool.hpp"
+#include "database_transaction.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <thread>
+#include <vector>
+
+namespace fenrir {
+
+    // Read/write splitting over a primary and its streaming replicas
+    // Holds one database_pool per host. Read-write work always goes to the
+    // primary; read-only work goes to the least-loaded replica that is healthy
+    // and whose replay lag is within max_replica_lag, and to the primary when
+    // no replica qualifies. Lag is sampled in the background.
+    class routing_pool {
+    public:
+        struct routing_config {
+            database_pool::pool_config primary;
+            std::vector<database_pool::pool_config> replicas;
+            std::chrono::milliseconds max_replica_lag{1000};     // Replicas further behind serve no reads
+            std::chrono::milliseconds lag_check_interval{1000};  // Lag sampling period (0 = only sample_lag())
+            double replica_wait_share = 0.5;  // Share of a read's timeout spent waiting on a saturated replica
+        };
+
+        // Health of one replica as of its last lag sample
+        struct replica_status {
+            bool healthy = false;
+            std::optional<std::chrono::milliseconds> lag;  // Unknown until sampled
+            size_t active_connections = 0;
+        };
+
+        explicit routing_pool(const routing_config& config)
+            : config_(config),
+              primary_(std::make_unique<database_pool>(config.primary)),
+              replica_state_(config.replicas.size()) {
+
+            replicas_.reserve(config.replicas.size());
+            for (const auto& replica_config : config.replicas) {
+                try {
+                    replicas_.push_back(std::make_unique<database_pool>(replica_config));
+                } catch (const database_error&) {
+                    // A replica that is down must not stop the application from
+                    // starting: keep an empty pool, which stays unhealthy until
+                    // a lag probe manages to connect
+                    auto lazy = replica_config;
+                    lazy.min_connections = 0;
+                    replicas_.push_back(std::make_unique<database_pool>(lazy));
+                }
+            }
+
+            // Route by measured lag from the first read on
+            sample_lag();
+
+            if (config_.lag_check_interval.count() > 0 && !replicas_.empty()) {
+                sampler_thread_ = detail::start_periodic(config_.lag_check_interval, [this] { sample_lag(); });
+            }
+        }
+
+        ~routing_pool() {
+            shutdown();
+        }
+
+        routing_pool(const routing_pool&) = delete;
+        routing_pool& operator=(const routing_pool&) = delete;
+
+        // Acquire a connection for work of the given access mode
+        // A replica that cannot connect (or whose circuit breaker is open) is
+        // marked unhealthy; one that is merely saturated stays in rotation.
+        // A read waits on its replica for at most replica_wait_share of timeout,
+        // so the fallback to the primary keeps the rest.
+        [[nodiscard]] pooled_connection acquire(
+            access_mode mode = access_mode::read_write,
+            std::chrono::milliseconds timeout = std::chrono::milliseconds(5000),
+            acquire_priority priority = acquire_priority::normal) {
+
+            auto deadline = std::chrono::steady_clock::now() + timeout;
+            if (mode == access_mode::read_only) {
+                if (auto replica = pick_replica()) {
+                    try {
+                        return replicas_[*replica]->acquire(replica_wait(timeout), priority);
+                    } catch (const pool_busy_error&) {
+                        // Saturated, not broken
+                    } catch (const database_error&) {
+                        mark_unhealthy(*replica);
+                    }
+                }
+            }
+            return primary_->acquire(remaining(deadline), priority);
+        }
+
+        [[nodiscard]] net::awaitable<pooled_connection> async_acquire(
+            access_mode mode = access_mode::read_write,
+            std::chrono::milliseconds timeout = std::chrono::milliseconds(5000),
+            acquire_priority priority = acquire_priority::normal) {
+
+            auto deadline = std::chrono::steady_clock::now() + timeout;
+            if (mode == access_mode::read_only) {
+                if (auto replica = pick_replica()) {
+                    std::optional<pooled_connection> conn;
+                    try {
+                        conn = co_await replicas_[*replica]->async_acquire(replica_wait(timeout), priority);
+                    } catch (const pool_busy_error&) {
+                        // Saturated, not broken
+                    } catch (const database_error&) {
+                        mark_unhealthy(*replica);
+                    }
+                    if (conn) co_return std::move(*conn);
+                }
+            }
+            co_return co_await primary_->async_acquire(remaining(deadline), priority);
+        }
+
+        // Run func in a transaction on a connection routed by mode
+        // Read-only transactions are opened READ ONLY, so a write that slips
+        // into one fails on the primary just as it would on a replica.
+        template<typename Func>
+        requires std::invocable<Func, database_transaction&>
+        auto with_transaction(
+            access_mode mode,
+            Func&& func,
+            isolation_level level = isolation_level::read_committed) {
+
+            auto conn = acquire(mode);
+            database_transaction txn(*conn, level, mode);
+
+            if constexpr (std::is_void_v<std::invoke_result_t<Func, database_transaction&>>) {
+                func(txn);
+                txn.commit();
+            } else {
+                auto result = func(txn);
+                txn.commit();
+                return result;
+            }
+        }
+
+        // Measure replay lag on every replica now
+        // A replica whose probe fails is unhealthy until a later probe succeeds.
+        // A replica with no free connection keeps its previous reading.
+        void sample_lag() {
+            for (size_t i = 0; i < replicas_.size(); ++i) {
+                auto& state = replica_state_[i];
+                try {
+                    auto conn = replicas_[i]->try_acquire();
+                    if (!conn) continue;  // Busy serving reads, so reachable
+
+                    query_result result((*conn)->execute(lag_query));
+                    auto lag_ms = result.get<double>(0, 0);
+                    state.lag_ms.store(lag_ms ? static_cast<std::int64_t>(*lag_ms) : unknown_lag,
+                                       std::memory_order_relaxed);
+                    state.healthy.store(true, std::memory_order_release);
+                } catch (const database_error&) {
+                    mark_unhealthy(i);
+                }
+            }
+        }
+
+        [[nodiscard]] replica_status status(size_t replica) const {
+            const auto& state = replica_state_.at(replica);
+            auto lag_ms = state.lag_ms.load(std::memory_order_relaxed);
+            return replica_status{
+                .healthy = state.healthy.load(std::memory_order_acquire),
+                .lag = lag_ms == unknown_lag ? std::nullopt
+                                             : std::optional{std::chrono::milliseconds{lag_ms}},
+                .active_connections = replicas_[replica]->get_stats().active_connections
+            };
+        }
+
+        [[nodiscard]] database_pool& primary() noexcept { return *primary_; }
+        [[nodiscard]] database_pool& replica(size_t index) { return *replicas_.at(index); }
+        [[nodiscard]] size_t replica_count() const noexcept { return replicas_.size(); }
+
+        void shutdown() {
+            if (sampler_thread_.joinable()) {
+                sampler_thread_.request_stop();
+                sampler_thread_.join();
+            }
+            primary_->shutdown();
+            for (auto& replica : replicas_) {
+                replica->shutdown();
+            }
+        }
+
+    private:
+        static constexpr std::int64_t unknown_lag = -1;
+
+        // Milliseconds the replica is behind; 0 when it has replayed all WAL it
+        // received (an idle primary leaves the last replay timestamp old), and
+        // 0 on a server that is not in recovery (e.g. a promoted replica).
+        // NULL (unknown, so no reads) while no WAL receiver is streaming: a
+        // replica cut off from its primary has replayed everything it has yet
+        // can be arbitrarily stale. Roles without pg_read_all_stats see no
+        // status, only whether a receiver process runs.
+        static constexpr const char* lag_query =
+            "SELECT CASE WHEN NOT pg_is_in_recovery() THEN 0 "
+            "WHEN NOT EXISTS (SELECT 1 FROM pg_stat_wal_receiver "
+            "WHERE coalesce(status, 'streaming') = 'streaming') THEN NULL "
+            "WHEN pg_last_wal_receive_lsn() = pg_last_wal_replay_lsn() THEN 0 "
+            "ELSE EXTRACT(EPOCH FROM now() - pg_last_xact_replay_timestamp()) * 1000 END";
+
+        struct replica_state {
+            std::atomic<bool> healthy{false};
+            std::atomic<std::int64_t> lag_ms{unknown_lag};
+        };
+
+        // Healthy replica within the lag limit with the lowest share of its
+        // connections in use
+        std::optional<size_t> pick_replica() const {
+            std::optional<size_t> best;
+            double best_load = std::numeric_limits<double>::max();
+
+            for (size_t i = 0; i < replicas_.size(); ++i) {
+                const auto& state = replica_state_[i];
+                if (!state.healthy.load(std::memory_order_acquire)) continue;
+                auto lag_ms = state.lag_ms.load(std::memory_order_relaxed);
+                if (lag_ms == unknown_lag || lag_ms > config_.max_replica_lag.count()) continue;
+
+                auto stats = replicas_[i]->get_stats();
+                double load = static_cast<double>(stats.active_connections) /
+                              static_cast<double>(std::max<size_t>(stats.max_connections, 1));
+                if (load < best_load) {
+                    best_load = load;
+                    best = i;
+                }
+            }
+            return best;
+        }
+
+        std::chrono::milliseconds replica_wait(std::chrono::milliseconds timeout) const {
+            double share = std::clamp(config_.replica_wait_share, 0.0, 1.0);
+            return std::chrono::duration_cast<std::chrono::milliseconds>(timeout * share);
+        }
+
+        static std::chrono::milliseconds remaining(std::chrono::steady_clock::time_point deadline) {
+            auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+                deadline - std::chrono::steady_clock::now());
+            return std::max(left, std::chrono::milliseconds{0});
+        }
+
+        void mark_unhealthy(size_t replica) noexcept {
+            replica_state_[replica].healthy.store(false, std::memory_order_release);
+        }
+
+        routing_config config_;
+        std::unique_ptr<database_pool> primary_;
+        std::vector<std::unique_ptr<database_pool>> replicas_;
+        std::vector<replica_state> replica_state_;
+        std::jthread sampler_thread_;
+    };
+
+} // namespace fenrir
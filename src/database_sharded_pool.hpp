@@ -0,0 +1,218 @@
+#pragma once
+
+#include "database_pool.hpp"
+#include <functional>
+#include <memory>
+#include <optional>
+#include <thread>
+#include <vector>
+#include <boost/asio/execution/context_as.hpp>
+
+namespace fenrir {
+
+    struct sharded_pool_options {
+        // Serve a caller from sibling shards when its own is exhausted,
+        // trading event-loop affinity for using the whole pool
+        bool work_stealing = false;
+    };
+
+    // Connection pool split into one database_pool per io_context (or per core)
+    // Each shard's connections are bound to that shard's io_context, and an
+    // acquire is served by the caller's own shard, so a connection's socket is
+    // only ever serviced by one event loop. With options::work_stealing, a
+    // caller whose shard has nothing to give may borrow a sibling's
+    // connection; while borrowed, its socket is waited on by the caller's
+    // event loop instead.
+    class sharded_pool {
+    public:
+        using options = sharded_pool_options;
+
+        // One shard per io_context. min_connections and max_connections in
+        // config are totals, spread evenly over the shards (max_connections
+        // must be at least one per shard); config.io_context is ignored.
+        sharded_pool(const database_pool::pool_config& config, const std::vector<net::io_context*>& io_contexts,
+                     const options& opts = {})
+            : io_contexts_(io_contexts), options_(opts) {
+            if (io_contexts_.empty()) {
+                throw database_error{"sharded_pool needs at least one io_context"};
+            }
+            create_shards(config, io_contexts_.size());
+        }
+
+        // Shards without async support, picked by the calling thread
+        sharded_pool(const database_pool::pool_config& config, size_t shard_count, const options& opts = {})
+            : options_(opts) {
+            if (shard_count == 0) {
+                throw database_error{"sharded_pool needs at least one shard"};
+            }
+            create_shards(config, shard_count);
+        }
+
+        ~sharded_pool() {
+            shutdown();
+        }
+
+        sharded_pool(const sharded_pool&) = delete;
+        sharded_pool& operator=(const sharded_pool&) = delete;
+
+        // Acquire from the calling thread's shard
+        // With work stealing, idle connections anywhere are used before a new
+        // one is opened, and new ones on siblings before waiting.
+        [[nodiscard]] pooled_connection acquire(
+            std::chrono::milliseconds timeout = std::chrono::milliseconds(5000),
+            acquire_priority priority = acquire_priority::normal) {
+
+            size_t home = home_shard();
+            for (bool open_new : {false, true}) {
+                if (auto conn = shards_[home]->try_acquire(open_new)) {
+                    return std::move(*conn);
+                }
+                if (auto conn = steal(home, open_new)) {
+                    return std::move(*conn);
+                }
+            }
+            return shards_[home]->acquire(timeout, priority);
+        }
+
+        // Acquire from the shard of the io_context running the coroutine
+        // Falls back to the calling thread's shard when the executor belongs to
+        // none of the pool's io_contexts.
+        [[nodiscard]] net::awaitable<pooled_connection> async_acquire(
+            std::chrono::milliseconds timeout = std::chrono::milliseconds(5000),
+            acquire_priority priority = acquire_priority::normal) {
+
+            auto executor = co_await net::this_coro::executor;
+            size_t home = shard_of(net::query(executor, net::execution::context_as<net::execution_context&>));
+            auto& pool = *shards_[home];
+
+            if (auto conn = pool.try_acquire(false)) {
+                co_return std::move(*conn);
+            }
+            // Grow the home shard (connecting asynchronously) before stealing;
+            // a sibling's new connection would be opened synchronously
+            auto stats = pool.get_stats();
+            if (stats.total_connections < stats.max_connections) {
+                co_return co_await pool.async_acquire(timeout, priority);
+            }
+            if (auto conn = steal(home, false)) {
+                co_return std::move(*conn);
+            }
+            co_return co_await pool.async_acquire(timeout, priority);
+        }
+
+        [[nodiscard]] size_t shard_count() const noexcept { return shards_.size(); }
+
+        [[nodiscard]] database_pool& shard(size_t index) { return *shards_.at(index); }
+
+        // Statistics summed over all shards
+        [[nodiscard]] database_pool::pool_stats get_stats() const {
+            database_pool::pool_stats total{};
+            for (const auto& shard : shards_) {
+                auto stats = shard->get_stats();
+                total.active_connections += stats.active_connections;
+                total.available_connections += stats.available_connections;
+                total.total_connections += stats.total_connections;
+                total.max_connections += stats.max_connections;
+            }
+            return total;
+        }
+
+        // Telemetry summed over all shards
+        [[nodiscard]] pool_metrics get_metrics() const {
+            pool_metrics total;
+            for (const auto& shard : shards_) {
+                total += shard->get_metrics();
+            }
+            return total;
+        }
+
+        // Run maintain() on every shard; returns number of connections removed
+        size_t maintain() {
+            size_t removed = 0;
+            for (auto& shard : shards_) {
+                removed += shard->maintain();
+            }
+            return removed;
+        }
+
+        void shutdown() {
+            if (maintenance_thread_.joinable()) {
+                maintenance_thread_.request_stop();
+                maintenance_thread_.join();
+            }
+            for (auto& shard : shards_) {
+                shard->shutdown();
+            }
+        }
+
+    private:
+        void create_shards(database_pool::pool_config config, size_t count) {
+            if (config.min_connections > config.max_connections) {
+                throw database_error{"min_connections cannot exceed max_connections"};
+            }
+
+            // One maintenance thread for the whole pool instead of one per shard
+            auto maintenance_interval = config.maintenance_interval;
+            auto on_metrics = std::move(config.on_metrics);
+            config.maintenance_interval = std::chrono::seconds{0};
+
+            if (config.max_connections < count) {
+                throw database_error{std::format(
+                    "max_connections ({}) must be at least the number of shards ({})",
+                    config.max_connections, count)};
+            }
+
+            size_t total_min = config.min_connections;
+            size_t total_max = config.max_connections;
+            shards_.reserve(count);
+            for (size_t i = 0; i < count; ++i) {
+                config.min_connections = share(total_min, count, i);
+                config.max_connections = share(total_max, count, i);
+                config.io_context = io_contexts_.empty() ? nullptr : io_contexts_[i];
+                shards_.push_back(std::make_unique<database_pool>(config));
+            }
+
+            if (maintenance_interval.count() > 0) {
+                maintenance_thread_ = detail::start_periodic(maintenance_interval, [this, on_metrics] {
+                    maintain();
+                    if (on_metrics) on_metrics(get_metrics());
+                });
+            }
+        }
+
+        // Shard index's part of total when split as evenly as possible
+        static size_t share(size_t total, size_t count, size_t index) noexcept {
+            return total / count + (index < total % count ? 1 : 0);
+        }
+
+        // Shard for synchronous callers; a thread always maps to the same one
+        size_t home_shard() const noexcept {
+            return std::hash<std::thread::id>{}(std::this_thread::get_id()) % shards_.size();
+        }
+
+        size_t shard_of(const net::execution_context& context) const noexcept {
+            for (size_t i = 0; i < io_contexts_.size(); ++i) {
+                if (io_contexts_[i] == &context) return i;
+            }
+            return home_shard();
+        }
+
+        // With work stealing, take a connection from another shard, nearest
+        // sibling first: an idle one, or with open_new a new one
+        std::optional<pooled_connection> steal(size_t home, bool open_new) {
+            if (!options_.work_stealing) return std::nullopt;
+            for (size_t offset = 1; offset < shards_.size(); ++offset) {
+                if (auto conn = shards_[(home + offset) % shards_.size()]->try_acquire(open_new)) {
+                    return conn;
+                }
+            }
+            return std::nullopt;
+        }
+
+        std::vector<net::io_context*> io_contexts_;
+        options options_;
+        std::vector<std::unique_ptr<database_pool>> shards_;
+        std::jthread maintenance_thread_;
+    };
+
+} // namespace fenrir
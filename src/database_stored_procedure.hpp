@@ -4,13 +4,83 @@
 #include "database_query.hpp"
 #include <vector>
 #include <string>
+#include <string_view>
 #include <format>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <algorithm>
+#include <exception>
+#include <optional>
 #include <boost/asio/awaitable.hpp>
+#include <boost/asio/co_spawn.hpp>
+#include <boost/asio/redirect_error.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/strand.hpp>
 
 namespace fenrir {
 
     namespace net = boost::asio;
 
+    namespace detail {
+
+        // Call plans shared by every database_stored_procedure in the process:
+        // one "SELECT * FROM proc($1, ...)" per procedure and arity, built
+        // once and prepared on each connection the first time it runs there
+        class call_plan_cache {
+        public:
+            [[nodiscard]] static std::shared_ptr<const statement_descriptor> get(
+                std::string_view procedure, size_t arity) {
+                
+                static call_plan_cache cache;
+                return cache.lookup(procedure, arity);
+            }
+
+        private:
+            struct name_hash {
+                using is_transparent = void;
+                size_t operator()(std::string_view name) const noexcept {
+                    return std::hash<std::string_view>{}(name);
+                }
+            };
+
+            using plans = std::vector<std::shared_ptr<const statement_descriptor>>;  // Indexed by arity
+
+            std::shared_ptr<const statement_descriptor> lookup(std::string_view procedure, size_t arity) {
+                std::lock_guard<std::mutex> lock(mutex_);
+                auto it = plans_.find(procedure);
+                if (it == plans_.end()) {
+                    it = plans_.emplace(std::string(procedure), plans{}).first;
+                }
+                auto& by_arity = it->second;
+                if (by_arity.size() <= arity) {
+                    by_arity.resize(arity + 1);
+                }
+                if (!by_arity[arity]) {
+                    by_arity[arity] = build(procedure, arity);
+                }
+                return by_arity[arity];
+            }
+
+            static std::shared_ptr<const statement_descriptor> build(std::string_view procedure, size_t arity) {
+                std::string args;
+                for (size_t i = 1; i <= arity; ++i) {
+                    args += std::format("{}${}", i > 1 ? ", " : "", i);
+                }
+
+                auto plan = std::make_shared<statement_descriptor>();
+                plan->sql = std::format("SELECT * FROM {}({})", procedure, args);
+                plan->name = statement_name(plan->sql, {});
+                return plan;
+            }
+
+            std::mutex mutex_;
+            std::unordered_map<std::string, plans, name_hash, std::equal_to<>> plans_;
+        };
+
+    } // namespace detail
+
     // Stored procedure parameter direction
     enum class param_direction {
         in,
@@ -25,25 +95,28 @@ namespace fenrir {
         param_direction direction = param_direction::in;
     };
 
-    // Stored procedure wrapper
-    class database_stored_procedure {
+    // A procedure name and its arguments, not tied to a connection
+    // Runs on whatever connection it is given, through a cached call plan
+    // prepared there on first use; see async_gather() to fan calls out over a
+    // pool.
+    class procedure_call {
     public:
-        explicit database_stored_procedure(database_connection& conn, std::string_view name)
-            : conn_(conn), proc_name_(name) {}
+        explicit procedure_call(std::string_view name) : proc_name_(name) {}
 
         // Add input parameter
         template<typename T>
-        database_stored_procedure& add_param(std::string_view name, const T& value) {
+        procedure_call& add_param(std::string_view name, const T& value) {
             params_.push_back(procedure_param{
                 .name = std::string(name),
                 .value = to_string(value),
                 .direction = param_direction::in
             });
+            ++in_count_;
             return *this;
         }
 
         // Add output parameter
-        database_stored_procedure& add_out_param(std::string_view name) {
+        procedure_call& add_out_param(std::string_view name) {
             params_.push_back(procedure_param{
                 .name = std::string(name),
                 .value = "",
@@ -54,69 +127,138 @@ namespace fenrir {
 
         // Add input/output parameter
         template<typename T>
-        database_stored_procedure& add_inout_param(std::string_view name, const T& value) {
+        procedure_call& add_inout_param(std::string_view name, const T& value) {
             params_.push_back(procedure_param{
                 .name = std::string(name),
                 .value = to_string(value),
                 .direction = param_direction::inout
             });
+            ++in_count_;
             return *this;
         }
 
-        // Execute stored procedure (synchronous)
-        [[nodiscard]] query_result execute() {
-            // Build parameter list for PostgreSQL function call
-            std::vector<std::string> param_placeholders;
-            std::vector<std::string> param_values;
-            
-            for (size_t i = 0; i < params_.size(); ++i) {
-                if (params_[i].direction != param_direction::out) {
-                    param_placeholders.push_back(std::format("${}", i + 1));
-                    param_values.push_back(params_[i].value);
-                }
+        // Execute on conn (synchronous)
+        // Runs the procedure's call plan, preparing it on conn on first use;
+        // out parameters are not passed.
+        [[nodiscard]] query_result execute(database_connection& conn) {
+            const auto& plan = call_plan();
+            detail::ensure_prepared(conn, plan);
+
+            auto values = param_values();
+            return query_result(conn.execute_prepared_raw(
+                plan.name, static_cast<int>(values.size()), values.data(), nullptr, nullptr));
+        }
+
+        // Execute on conn (asynchronous)
+        // Waits on the connection's socket like any other async query.
+        [[nodiscard]] net::awaitable<query_result> async_execute(database_connection& conn) {
+            const auto& plan = call_plan();
+            if (!conn.is_prepared(plan.name)) {
+                co_await conn.async_prepare(plan.name, plan.sql);
             }
 
-            std::string sql;
-            if (param_placeholders.empty()) {
-                sql = std::format("SELECT * FROM {}()", proc_name_);
-                auto result = conn_.execute(sql);
-                return query_result(result);
+            auto values = param_values();
+            co_return co_await conn.async_execute_prepared_raw(
+                plan.name, static_cast<int>(values.size()), values.data(), nullptr, nullptr);
+        }
+
+        // Clear all parameters
+        procedure_call& clear_params() {
+            params_.clear();
+            in_count_ = 0;
+            return *this;
+        }
+
+        // Get procedure name
+        [[nodiscard]] const std::string& name() const noexcept {
+            return proc_name_;
+        }
+
+    private:
+        template<typename T>
+        static std::string to_string(const T& value) {
+            if constexpr (std::is_same_v<std::decay_t<T>, std::string>) {
+                return value;
+            } else if constexpr (std::is_same_v<std::decay_t<T>, const char*>) {
+                return std::string(value);
+            } else if constexpr (std::is_same_v<std::decay_t<T>, std::string_view>) {
+                return std::string(value);
+            } else if constexpr (std::is_arithmetic_v<std::decay_t<T>>) {
+                return std::to_string(value);
+            } else if constexpr (std::is_same_v<std::decay_t<T>, bool>) {
+                return value ? "true" : "false";
+            } else if constexpr (detail::array_param<std::decay_t<T>>) {
+                return detail::array_literal(value);
             } else {
-                sql = std::format("SELECT * FROM {}({})", 
-                                 proc_name_,
-                                 join_strings(param_placeholders, ", "));
-                
-                // Execute with parameters
-                auto result = execute_with_params(sql, param_values);
-                return query_result(result);
+                return std::format("{}", value);
             }
         }
 
-        // Execute stored procedure (asynchronous)
-        [[nodiscard]] net::awaitable<query_result> async_execute() {
-            // Build parameter list for PostgreSQL function call
-            std::vector<std::string> param_placeholders;
-            std::vector<std::string> param_values;
-            
-            for (size_t i = 0; i < params_.size(); ++i) {
-                if (params_[i].direction != param_direction::out) {
-                    param_placeholders.push_back(std::format("${}", i + 1));
-                    param_values.push_back(params_[i].value);
+        // Plan for the current number of in/inout parameters
+        const detail::statement_descriptor& call_plan() {
+            if (!plan_ || plan_arity_ != in_count_) {
+                plan_ = detail::call_plan_cache::get(proc_name_, in_count_);
+                plan_arity_ = in_count_;
+            }
+            return *plan_;
+        }
+
+        // Text values of the in/inout parameters, in order
+        std::vector<const char*> param_values() const {
+            std::vector<const char*> values;
+            values.reserve(in_count_);
+            for (const auto& param : params_) {
+                if (param.direction != param_direction::out) {
+                    values.push_back(param.value.c_str());
                 }
             }
+            return values;
+        }
 
-            std::string sql;
-            if (param_placeholders.empty()) {
-                sql = std::format("SELECT * FROM {}()", proc_name_);
-                co_return co_await conn_.async_execute(sql);
-            } else {
-                sql = std::format("SELECT * FROM {}({})", 
-                                 proc_name_,
-                                 join_strings(param_placeholders, ", "));
-                
-                // Execute with parameters asynchronously
-                co_return co_await async_execute_with_params(sql, param_values);
+        std::string proc_name_;
+        std::vector<procedure_param> params_;
+        size_t in_count_ = 0;                                       // In and inout parameters
+        std::shared_ptr<const detail::statement_descriptor> plan_;  // Plan for plan_arity_ arguments
+        size_t plan_arity_ = 0;
+    };
+
+    // Stored procedure wrapper
+    class database_stored_procedure {
+    public:
+        explicit database_stored_procedure(database_connection& conn, std::string_view name)
+            : conn_(conn), call_(name) {}
+
+        // Add input parameter
+        template<typename T>
+        database_stored_procedure& add_param(std::string_view name, const T& value) {
+            call_.add_param(name, value);
+            return *this;
+        }
+
+        // Add output parameter
+        database_stored_procedure& add_out_param(std::string_view name) {
+            call_.add_out_param(name);
+            return *this;
+        }
+
+        // Add input/output parameter
+        template<typename T>
+        database_stored_procedure& add_inout_param(std::string_view name, const T& value) {
+            call_.add_inout_param(name, value);
+            return *this;
+        }
+
+        // Execute stored procedure (synchronous)
+        [[nodiscard]] query_result execute() {
+            return call_.execute(conn_);
+        }
+
+        // Execute stored procedure (asynchronous)
+        [[nodiscard]] net::awaitable<query_result> async_execute() {
+            if (!conn_.get_io_context()) {
+                throw database_error{"io_context not set. Call set_io_context() first."};
             }
+            co_return co_await call_.async_execute(conn_);
         }
 
         // Execute as a function returning single value (synchronous)
@@ -145,157 +287,121 @@ namespace fenrir {
 
         // Clear all parameters
         database_stored_procedure& clear_params() {
-            params_.clear();
+            call_.clear_params();
             return *this;
         }
 
         // Get procedure name
         [[nodiscard]] const std::string& name() const noexcept {
-            return proc_name_;
+            return call_.name();
         }
 
-    private:
-        template<typename T>
-        static std::string to_string(const T& value) {
-            if constexpr (std::is_same_v<std::decay_t<T>, std::string>) {
-                return value;
-            } else if constexpr (std::is_same_v<std::decay_t<T>, const char*>) {
-                return std::string(value);
-            } else if constexpr (std::is_same_v<std::decay_t<T>, std::string_view>) {
-                return std::string(value);
-            } else if constexpr (std::is_arithmetic_v<std::decay_t<T>>) {
-                return std::to_string(value);
-            } else if constexpr (std::is_same_v<std::decay_t<T>, bool>) {
-                return value ? "true" : "false";
-            } else {
-                return std::format("{}", value);
-            }
+        // The call this wrapper runs, e.g. to hand to async_gather()
+        [[nodiscard]] const procedure_call& call() const noexcept {
+            return call_;
         }
 
-        static std::string join_strings(const std::vector<std::string>& strings, 
-                                       std::string_view delimiter) {
-            if (strings.empty()) return "";
-            
-            std::string result = strings[0];
-            for (size_t i = 1; i < strings.size(); ++i) {
-                result += delimiter;
-                result += strings[i];
-            }
-            return result;
-        }
-
-        PGresult* execute_with_params(
-            std::string_view sql, const std::vector<std::string>& values) {
-            
-            std::vector<const char*> param_ptrs;
-            for (const auto& val : values) {
-                param_ptrs.push_back(val.c_str());
-            }
+    private:
+        database_connection& conn_;
+        procedure_call call_;
+    };
 
-            PGresult* result = PQexecParams(
-                conn_.native_handle(),
-                sql.data(),
-                static_cast<int>(param_ptrs.size()),
-                nullptr,
-                param_ptrs.data(),
-                nullptr,
-                nullptr,
-                0
-            );
-
-            if (!result) {
-                throw database_error{
-                    std::format("Stored procedure execution failed: {}", conn_.last_error())
-                };
-            }
+    // Results of async_gather(), in call order
+    // Every call runs to completion whether or not the others fail.
+    struct gather_result {
+        std::vector<std::optional<query_result>> results;  // Empty where the call failed
+        std::vector<std::exception_ptr> errors;             // Null where it succeeded
 
-            ExecStatusType status = PQresultStatus(result);
-            if (status != PGRES_COMMAND_OK && status != PGRES_TUPLES_OK) {
-                std::string error_msg = PQresultErrorMessage(result);
-                std::string sql_state = PQresultErrorField(result, PG_DIAG_SQLSTATE);
-                PQclear(result);
-                throw database_error{std::move(error_msg), std::move(sql_state)};
-            }
+        [[nodiscard]] size_t size() const noexcept {
+            return results.size();
+        }
 
-            return result;
+        // Whether every call succeeded
+        [[nodiscard]] bool ok() const noexcept {
+            return std::ranges::none_of(errors, [](const std::exception_ptr& error) { return bool(error); });
         }
 
-        net::awaitable<query_result> async_execute_with_params(
-            std::string_view sql, const std::vector<std::string>& values) {
-            
-            if (!conn_.is_connected()) {
-                throw database_error{"Connection is not valid"};
-            }
-            if (!conn_.get_io_context()) {
-                throw database_error{"io_context not set. Call set_io_context() first."};
+        // Result of call index; rethrows its error if it failed
+        [[nodiscard]] const query_result& get(size_t index) const {
+            if (errors.at(index)) {
+                std::rethrow_exception(errors[index]);
             }
+            return *results[index];
+        }
+    };
 
-            std::vector<const char*> param_ptrs;
-            for (const auto& val : values) {
-                param_ptrs.push_back(val.c_str());
+    namespace detail {
+
+        // State of one async_gather() batch, shared by the batch and its calls
+        // so that the calls never outlive what they write to, even when the
+        // awaiting coroutine is cancelled and returns first
+        struct gather_state {
+            gather_state(std::vector<procedure_call> batch, net::any_io_executor executor)
+                : calls(std::move(batch)),
+                  remaining(calls.size()),
+                  all_done(executor, net::steady_timer::time_point::max()) {
+                gathered.results.resize(calls.size());
+                gathered.errors.resize(calls.size());
             }
 
-            // Send parameterized query asynchronously
-            if (!PQsendQueryParams(
-                conn_.native_handle(),
-                sql.data(),
-                static_cast<int>(param_ptrs.size()),
-                nullptr,
-                param_ptrs.data(),
-                nullptr,
-                nullptr,
-                0)) {
-                throw database_error{
-                    std::format("Stored procedure execution failed: {}", conn_.last_error())
-                };
+            std::vector<procedure_call> calls;
+            gather_result gathered;
+            size_t remaining;
+            net::steady_timer all_done;     // Cancelled by the last call to finish
+        };
+
+        template<typename Pool>
+        net::awaitable<void> gather_call(Pool& pool, std::shared_ptr<gather_state> state, size_t index) {
+            try {
+                auto conn = co_await pool.async_acquire();
+                state->gathered.results[index] = co_await state->calls[index].async_execute(*conn);
+            } catch (...) {
+                state->gathered.errors[index] = std::current_exception();
             }
+        }
 
-            // Wait for result asynchronously
+        // Runs on a strand, like the calls it spawns, so the bookkeeping
+        // below needs no locking
+        template<typename Pool>
+        net::awaitable<gather_result> gather_on_strand(Pool& pool, std::vector<procedure_call> calls) {
             auto executor = co_await net::this_coro::executor;
-            net::steady_timer timer(executor);
-            
-            while (true) {
-                // Check if result is ready (non-blocking)
-                if (PQconsumeInput(conn_.native_handle()) == 0) {
-                    throw database_error{
-                        std::format("Failed to consume input: {}", conn_.last_error())
-                    };
-                }
-
-                if (PQisBusy(conn_.native_handle()) == 0) {
-                    // Result is ready
-                    PGresult* result = PQgetResult(conn_.native_handle());
-                    
-                    if (!result) {
-                        throw database_error{"Query returned no result"};
-                    }
-
-                    ExecStatusType status = PQresultStatus(result);
-                    if (status != PGRES_COMMAND_OK && status != PGRES_TUPLES_OK) {
-                        std::string error_msg = PQresultErrorMessage(result);
-                        std::string sql_state = PQresultErrorField(result, PG_DIAG_SQLSTATE);
-                        PQclear(result);
-                        throw database_error{std::move(error_msg), std::move(sql_state)};
-                    }
-
-                    // Consume remaining results
-                    PGresult* extra = nullptr;
-                    while ((extra = PQgetResult(conn_.native_handle())) != nullptr) {
-                        PQclear(extra);
-                    }
-
-                    co_return query_result(result);
-                }
+            auto state = std::make_shared<gather_state>(std::move(calls), executor);
+            for (size_t i = 0; i < state->calls.size(); ++i) {
+                net::co_spawn(executor, gather_call(pool, state, i),
+                    [state](std::exception_ptr) {
+                        if (--state->remaining == 0) {
+                            state->all_done.cancel();
+                        }
+                    });
+            }
 
-                // Not ready yet, wait a bit
-                timer.expires_after(std::chrono::milliseconds(1));
-                co_await timer.async_wait(net::use_awaitable);
+            if (state->remaining > 0) {
+                boost::system::error_code ec;
+                co_await state->all_done.async_wait(net::redirect_error(net::use_awaitable, ec));
             }
+            if (state->remaining > 0) {
+                // Cancelled from outside: the calls finish on their own and
+                // return their connections to the pool
+                throw boost::system::system_error(net::error::operation_aborted);
+            }
+            co_return std::move(state->gathered);
         }
 
-        database_connection& conn_;
-        std::string proc_name_;
-        std::vector<procedure_param> params_;
-    };
-
-} // namespace fenrir
\ No newline at end of file
+    } // namespace detail
+
+    // Run calls concurrently, each on its own connection from pool
+    // (database_pool, sharded_pool, ...), and collect their results in call
+    // order. The pool's connections need an io_context for async queries
+    // (pool_config::io_context). The batch takes about as long as its slowest
+    // call, as long as the pool has a connection for each one. If the
+    // awaiting coroutine is cancelled, the calls still run to completion, so
+    // the pool must outlive them.
+    template<typename Pool>
+    requires requires(Pool& pool) { pool.async_acquire(); }
+    [[nodiscard]] net::awaitable<gather_result> async_gather(Pool& pool, std::vector<procedure_call> calls) {
+        auto executor = co_await net::this_coro::executor;
+        co_return co_await net::co_spawn(net::make_strand(executor),
+            detail::gather_on_strand(pool, std::move(calls)), net::use_awaitable);
+    }
+
+} // namespace fenrir
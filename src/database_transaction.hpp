@@ -8,8 +8,12 @@
 #include <atomic>
 #include <vector>
 #include <optional>
+#include <thread>
+#include <exception>
+#include <type_traits>
 #include "database_connection.hpp"
 #include "database_query.hpp"
+#include "database_retry.hpp"
 
 namespace fenrir {
 
@@ -27,6 +31,33 @@ namespace fenrir {
         read_only
     };
 
+    // BEGIN statement for the given transaction characteristics
+    [[nodiscard]] inline std::string begin_statement(
+        isolation_level level = isolation_level::read_committed,
+        access_mode mode = access_mode::read_write,
+        bool deferrable = false) {
+        
+        std::string isolation_str = [level]() {
+            switch (level) {
+                case isolation_level::read_uncommitted:
+                    return "READ UNCOMMITTED";
+                case isolation_level::read_committed:
+                    return "READ COMMITTED";
+                case isolation_level::repeatable_read:
+                    return "REPEATABLE READ";
+                case isolation_level::serializable:
+                    return "SERIALIZABLE";
+                default:
+                    return "READ COMMITTED";
+            }
+        }();
+
+        std::string mode_str = mode == access_mode::read_only ? "READ ONLY" : "READ WRITE";
+        std::string defer_str = deferrable ? "DEFERRABLE" : "";
+
+        return std::format("BEGIN TRANSACTION ISOLATION LEVEL {} {} {}", isolation_str, mode_str, defer_str);
+    }
+
     // Savepoint RAII wrapper
     class savepoint {
     public:
@@ -67,7 +98,181 @@ namespace fenrir {
         bool released_;
     };
 
+    // How a database_transaction starts
+    struct transaction_options {
+        isolation_level level = isolation_level::read_committed;
+        access_mode mode = access_mode::read_write;
+        bool deferrable = false;
+        bool lazy_begin = false;    // Send BEGIN in the same pipeline flush as the first statement
+    };
+
+    namespace detail {
+
+        // Result slot of a write queued with execute_deferred()
+        struct deferred_state {
+            std::optional<query_result> result;
+            std::optional<database_error> error;
+        };
+
+        struct pending_statement {
+            std::string sql;
+            std::vector<std::string> params;
+            std::shared_ptr<deferred_state> state;  // Null for statements run directly
+        };
+
+        // What a database_transaction has not sent yet: a lazy BEGIN and the
+        // queued writes. Shared with the deferred_results of those writes so
+        // reading one can flush the queue.
+        class transaction_batch {
+        public:
+            transaction_batch(database_connection& conn, std::string begin_sql)
+                : conn_(conn), begin_sql_(std::move(begin_sql)) {}
+
+            void begin() {
+                PQclear(conn_.execute(begin_sql_));
+                begun_ = true;
+            }
+
+            // True when nothing is waiting to be sent
+            [[nodiscard]] bool idle() const noexcept {
+                return begun_ && queued_.empty();
+            }
+
+            [[nodiscard]] bool begun() const noexcept { return begun_; }
+            [[nodiscard]] std::size_t size() const noexcept { return queued_.size(); }
+
+            void enqueue(pending_statement statement) {
+                queued_.push_back(std::move(statement));
+            }
+
+            // Send the pending BEGIN, the queued writes and then last (if any)
+            // as one pipeline; returns last's result
+            // Every queued write's slot is filled before the first error is
+            // thrown; writes the server skipped get that error as well.
+            query_result run(std::optional<pending_statement> last) {
+                auto statements = std::exchange(queued_, {});
+                if (last) {
+                    statements.push_back(std::move(*last));
+                }
+
+                database_pipeline pipeline(conn_);
+                if (!begun_) {
+                    pipeline.send(begin_sql_);
+                    begun_ = true;
+                }
+                for (const auto& statement : statements) {
+                    std::vector<const char*> values;
+                    values.reserve(statement.params.size());
+                    for (const auto& param : statement.params) {
+                        values.push_back(param.c_str());
+                    }
+                    pipeline.send_raw(statement.sql, static_cast<int>(values.size()), nullptr,
+                                      values.data(), nullptr, nullptr);
+                }
+
+                auto outcomes = pipeline.sync_each();
+                std::optional<database_error> first_error;
+                for (const auto& outcome : outcomes) {
+                    if (outcome.error && !outcome.skipped) {
+                        first_error = outcome.error;
+                        break;
+                    }
+                }
+
+                // A BEGIN sent above is the first outcome
+                size_t offset = outcomes.size() - statements.size();
+                for (size_t i = 0; i < statements.size(); ++i) {
+                    auto& outcome = outcomes[offset + i];
+                    if (auto& state = statements[i].state) {
+                        if (outcome.skipped && first_error) {
+                            state->error = first_error;
+                        } else {
+                            state->error = std::move(outcome.error);
+                        }
+                        state->result = std::move(outcome.result);
+                    }
+                }
+
+                if (first_error) {
+                    throw *first_error;
+                }
+                if (!last || outcomes.empty()) {
+                    return query_result(nullptr);
+                }
+                return std::move(*outcomes.back().result);
+            }
+
+            void flush() {
+                if (!idle()) {
+                    (void)run(std::nullopt);
+                }
+            }
+
+            // Drop the queued writes unsent, failing their results with reason
+            void discard(const database_error& reason) {
+                for (auto& statement : std::exchange(queued_, {})) {
+                    if (statement.state) {
+                        statement.state->error = reason;
+                    }
+                }
+            }
+
+        private:
+            database_connection& conn_;
+            std::string begin_sql_;
+            bool begun_ = false;                        // BEGIN has been sent
+            std::vector<pending_statement> queued_;     // execute_deferred() writes not yet sent
+        };
+
+    } // namespace detail
+
+    // Result of a write queued with database_transaction::execute_deferred()
+    // Reading it sends the transaction's queue if it has not gone out yet.
+    // It stays readable after the transaction ends.
+    class deferred_result {
+    public:
+        // Whether the write has been sent and answered
+        [[nodiscard]] bool ready() const noexcept {
+            return state_->result || state_->error;
+        }
+
+        // The write's result, flushing the queue first if needed
+        // Throws the first error of the flush, or the one this write failed with.
+        [[nodiscard]] const query_result& get() {
+            if (!ready()) {
+                if (auto batch = batch_.lock()) {
+                    batch->flush();
+                }
+            }
+            if (state_->error) {
+                throw *state_->error;
+            }
+            if (!state_->result) {
+                throw database_error{"Deferred write was never sent"};
+            }
+            return *state_->result;
+        }
+
+    private:
+        friend class database_transaction;
+
+        deferred_result(std::weak_ptr<detail::transaction_batch> batch,
+                        std::shared_ptr<detail::deferred_state> state)
+            : batch_(std::move(batch)), state_(std::move(state)) {}
+
+        std::weak_ptr<detail::transaction_batch> batch_;
+        std::shared_ptr<detail::deferred_state> state_;
+    };
+
     // RAII transaction wrapper
+    // With transaction_options::lazy_begin, BEGIN waits for the first
+    // statement and goes out with it in one pipeline, and a transaction that
+    // never runs a statement costs no round trip at all.
+    //
+    // Writes queued with execute_deferred() are not sent on their own: the
+    // whole queue goes out as one pipeline with the next statement, savepoint
+    // or COMMIT, or when one of their deferred_results is read. Errors are
+    // raised at that point.
     class database_transaction {
     public:
         explicit database_transaction(
@@ -75,30 +280,16 @@ namespace fenrir {
             isolation_level level = isolation_level::read_committed,
             access_mode mode = access_mode::read_write,
             bool deferrable = false)
-            : conn_(conn), committed_(false), rolled_back_(false) {
-            
-            std::string isolation_str = [level]() {
-                switch (level) {
-                    case isolation_level::read_uncommitted:
-                        return "READ UNCOMMITTED";
-                    case isolation_level::read_committed:
-                        return "READ COMMITTED";
-                    case isolation_level::repeatable_read:
-                        return "REPEATABLE READ";
-                    case isolation_level::serializable:
-                        return "SERIALIZABLE";
-                    default:
-                        return "READ COMMITTED";
-                }
-            }();
-
-            std::string mode_str = mode == access_mode::read_only ? "READ ONLY" : "READ WRITE";
-            std::string defer_str = deferrable ? "DEFERRABLE" : "";
+            : database_transaction(conn, transaction_options{.level = level, .mode = mode, .deferrable = deferrable}) {}
 
-            std::string begin_cmd = std::format("BEGIN TRANSACTION ISOLATION LEVEL {} {} {}",
-                                                isolation_str, mode_str, defer_str);
+        database_transaction(database_connection& conn, const transaction_options& options)
+            : conn_(conn), committed_(false), rolled_back_(false),
+              batch_(std::make_shared<detail::transaction_batch>(
+                  conn, begin_statement(options.level, options.mode, options.deferrable))) {
             
-            PQclear(conn_.execute(begin_cmd));
+            if (!options.lazy_begin) {
+                batch_->begin();
+            }
         }
 
         ~database_transaction() {
@@ -120,7 +311,8 @@ namespace fenrir {
             : conn_(other.conn_),
               committed_(std::exchange(other.committed_, true)),
               rolled_back_(std::exchange(other.rolled_back_, true)),
-              savepoints_(std::move(other.savepoints_)) {}
+              savepoints_(std::move(other.savepoints_)),
+              batch_(std::move(other.batch_)) {}
 
         // Commit transaction
         void commit() {
@@ -128,17 +320,27 @@ namespace fenrir {
                 throw database_error{"Transaction already finalized"};
             }
 
-            PQclear(conn_.execute("COMMIT"));
+            if (!batch_->begun() && batch_->size() == 0) {
+                // Nothing was ever sent: there is nothing to commit
+            } else if (batch_->idle()) {
+                PQclear(conn_.execute("COMMIT"));
+            } else {
+                (void)batch_->run(detail::pending_statement{.sql = "COMMIT", .params = {}, .state = nullptr});
+            }
             committed_ = true;
         }
 
         // Rollback transaction
+        // Queued writes are dropped unsent.
         void rollback() {
             if (committed_ || rolled_back_) {
                 throw database_error{"Transaction already finalized"};
             }
 
-            PQclear(conn_.execute("ROLLBACK"));
+            batch_->discard(database_error{"Transaction rolled back before the write was sent"});
+            if (batch_->begun()) {
+                PQclear(conn_.execute("ROLLBACK"));
+            }
             rolled_back_ = true;
         }
 
@@ -147,6 +349,7 @@ namespace fenrir {
             if (committed_ || rolled_back_) {
                 throw database_error{"Cannot create savepoint in finalized transaction"};
             }
+            flush();
             return savepoint(conn_, name);
         }
 
@@ -156,8 +359,10 @@ namespace fenrir {
                 throw database_error{"Transaction already finalized"};
             }
 
-            auto result = conn_.execute(sql);
-            return query_result(result);
+            if (batch_->idle()) {
+                return query_result(conn_.execute(sql));
+            }
+            return batch_->run(detail::pending_statement{.sql = std::string(sql), .params = {}, .state = nullptr});
         }
 
         // Execute parameterized query within transaction
@@ -169,8 +374,28 @@ namespace fenrir {
                 throw database_error{"Transaction already finalized"};
             }
 
-            auto result = conn_.execute_params(sql, std::forward<Args>(args)...);
-            return query_result(result);
+            if (batch_->idle()) {
+                return query_result(conn_.execute_params(sql, std::forward<Args>(args)...));
+            }
+            return batch_->run(make_statement(sql, std::forward<Args>(args)...));
+        }
+
+        // Queue a write without waiting for it
+        // Discard the returned handle for fire-and-forget writes; any error
+        // they cause is thrown from the next flush.
+        deferred_result execute_deferred(std::string_view sql) {
+            return enqueue(detail::pending_statement{.sql = std::string(sql), .params = {}, .state = nullptr});
+        }
+
+        template<typename... Args>
+        deferred_result execute_params_deferred(std::string_view sql, Args&&... args) {
+            return enqueue(make_statement(sql, std::forward<Args>(args)...));
+        }
+
+        // Send a pending BEGIN and any queued writes now
+        // Needed before running statements on connection() directly.
+        void flush() {
+            batch_->flush();
         }
 
         // Check transaction state
@@ -186,16 +411,39 @@ namespace fenrir {
             return rolled_back_;
         }
 
+        // Number of queued writes not yet sent
+        [[nodiscard]] std::size_t deferred_count() const noexcept {
+            return batch_ ? batch_->size() : 0;
+        }
+
         // Get underlying connection
         [[nodiscard]] database_connection& connection() noexcept {
             return conn_;
         }
 
     private:
+        template<typename... Args>
+        [[nodiscard]] static detail::pending_statement make_statement(std::string_view sql, Args&&... args) {
+            detail::pending_statement statement{.sql = std::string(sql), .params = {}, .state = nullptr};
+            (statement.params.push_back(database_connection::to_string(std::forward<Args>(args))), ...);
+            return statement;
+        }
+
+        deferred_result enqueue(detail::pending_statement statement) {
+            if (committed_ || rolled_back_) {
+                throw database_error{"Transaction already finalized"};
+            }
+            auto state = std::make_shared<detail::deferred_state>();
+            statement.state = state;
+            batch_->enqueue(std::move(statement));
+            return deferred_result(batch_, std::move(state));
+        }
+
         database_connection& conn_;
         bool committed_;
         bool rolled_back_;
         std::vector<std::string> savepoints_;
+        std::shared_ptr<detail::transaction_batch> batch_;  // Shared with deferred_results
     };
 
     // Scoped transaction helper with automatic rollback on exception
@@ -204,9 +452,9 @@ namespace fenrir {
     auto with_transaction(
         database_connection& conn,
         Func&& func,
-        isolation_level level = isolation_level::read_committed) {
+        const transaction_options& options) {
         
-        database_transaction txn(conn, level);
+        database_transaction txn(conn, options);
         
         try {
             if constexpr (std::is_void_v<std::invoke_result_t<Func, database_transaction&>>) {
@@ -225,4 +473,259 @@ namespace fenrir {
         }
     }
 
+    template<typename Func>
+    requires std::invocable<Func, database_transaction&>
+    auto with_transaction(
+        database_connection& conn,
+        Func&& func,
+        isolation_level level = isolation_level::read_committed) {
+        
+        return with_transaction(conn, std::forward<Func>(func), transaction_options{.level = level});
+    }
+
+    // with_transaction that reruns func on a fresh transaction after a
+    // serialization failure (40001) or deadlock (40P01)
+    // The server rolled the failed attempt back entirely, so rerunning it is
+    // safe whatever policy.idempotent says; any other error is rethrown at
+    // once. Attempts are spaced by the policy's jittered backoff and stop at
+    // max_attempts or the deadline. policy.on_retry sees every retry, e.g.
+    // to count them.
+    template<typename Func>
+    requires std::invocable<Func&, database_transaction&>
+    auto with_transaction(
+        database_connection& conn,
+        Func&& func,
+        const transaction_options& options,
+        const retry_policy& policy) {
+        
+        retry_policy rerun = policy;
+        rerun.idempotent = true;
+        rerun.retry_serialization_failures = true;
+        detail::retry_schedule schedule(rerun);
+        while (true) {
+            try {
+                return with_transaction(conn, func, options);
+            } catch (const database_error& e) {
+                auto reason = classify_error(e);
+                if (reason != retry_reason::serialization_failure && reason != retry_reason::deadlock) {
+                    throw;
+                }
+                auto delay = schedule.next(reason);
+                if (!delay) throw;
+                schedule.notify(e, reason, *delay);
+                std::this_thread::sleep_for(*delay);
+            }
+        }
+    }
+
+    template<typename Func>
+    requires std::invocable<Func&, database_transaction&>
+    auto with_transaction(
+        database_connection& conn,
+        Func&& func,
+        isolation_level level,
+        const retry_policy& policy) {
+        
+        return with_transaction(conn, std::forward<Func>(func), transaction_options{.level = level}, policy);
+    }
+
+    // Coroutine counterpart of database_transaction
+    // BEGIN, COMMIT, ROLLBACK and every statement go through the connection's
+    // async API, so the io thread is never blocked. Obtain one with
+    // co_await async_transaction::begin(conn). A transaction destroyed while
+    // still open (its coroutine was destroyed mid-flight) is rolled back
+    // synchronously, like database_transaction, unless a query is still
+    // running on the connection; a pool discards such connections on return.
+    class async_transaction {
+    public:
+        [[nodiscard]] static net::awaitable<async_transaction> begin(
+            database_connection& conn,
+            isolation_level level = isolation_level::read_committed,
+            access_mode mode = access_mode::read_write,
+            bool deferrable = false) {
+            
+            (void)co_await conn.async_execute(begin_statement(level, mode, deferrable));
+            co_return async_transaction(conn);
+        }
+
+        ~async_transaction() {
+            if (conn_ && is_active()) {
+                auto status = conn_->transaction_status();
+                if (status == PQTRANS_INTRANS || status == PQTRANS_INERROR) {
+                    try {
+                        PQclear(conn_->execute("ROLLBACK"));
+                    } catch (...) {
+                        // Ignore errors in destructor
+                    }
+                }
+            }
+        }
+
+        // Disable copy, enable move
+        async_transaction(const async_transaction&) = delete;
+        async_transaction& operator=(const async_transaction&) = delete;
+        
+        async_transaction(async_transaction&& other) noexcept
+            : conn_(std::exchange(other.conn_, nullptr)),
+              committed_(std::exchange(other.committed_, true)),
+              rolled_back_(std::exchange(other.rolled_back_, true)) {}
+
+        // Commit transaction
+        // A failed COMMIT ends the transaction too: the server rolls it back.
+        net::awaitable<void> async_commit() {
+            check_active();
+            try {
+                (void)co_await conn_->async_execute("COMMIT");
+            } catch (...) {
+                rolled_back_ = true;
+                throw;
+            }
+            committed_ = true;
+        }
+
+        // Rollback transaction
+        net::awaitable<void> async_rollback() {
+            check_active();
+            rolled_back_ = true;
+            (void)co_await conn_->async_execute("ROLLBACK");
+        }
+
+        // Execute query within transaction
+        [[nodiscard]] net::awaitable<query_result> async_execute(std::string_view sql) {
+            check_active();
+            co_return co_await conn_->async_execute(sql);
+        }
+
+        // Execute parameterized query within transaction
+        template<typename... Args>
+        [[nodiscard]] net::awaitable<query_result> async_execute_params(
+            std::string_view sql, Args&&... args) {
+            
+            check_active();
+            co_return co_await conn_->async_execute_params(sql, std::forward<Args>(args)...);
+        }
+
+        // Savepoints
+        net::awaitable<void> async_savepoint(std::string_view name) {
+            check_active();
+            (void)co_await conn_->async_execute(std::format("SAVEPOINT {}", name));
+        }
+
+        net::awaitable<void> async_release_savepoint(std::string_view name) {
+            check_active();
+            (void)co_await conn_->async_execute(std::format("RELEASE SAVEPOINT {}", name));
+        }
+
+        net::awaitable<void> async_rollback_to_savepoint(std::string_view name) {
+            check_active();
+            (void)co_await conn_->async_execute(std::format("ROLLBACK TO SAVEPOINT {}", name));
+        }
+
+        // Run func(*this) inside a savepoint: released on success, rolled back
+        // to (leaving the transaction usable) if func throws
+        template<typename Func>
+        requires std::invocable<Func, async_transaction&>
+        auto async_with_savepoint(std::string name, Func func) -> std::invoke_result_t<Func, async_transaction&> {
+            co_await async_savepoint(name);
+            std::exception_ptr error;
+            try {
+                if constexpr (std::is_void_v<typename std::invoke_result_t<Func, async_transaction&>::value_type>) {
+                    co_await func(*this);
+                    co_await async_release_savepoint(name);
+                    co_return;
+                } else {
+                    auto result = co_await func(*this);
+                    co_await async_release_savepoint(name);
+                    co_return result;
+                }
+            } catch (...) {
+                error = std::current_exception();
+            }
+            if (is_active()) {
+                co_await async_rollback_to_savepoint(name);
+            }
+            std::rethrow_exception(error);
+        }
+
+        // Check transaction state
+        [[nodiscard]] bool is_active() const noexcept {
+            return !committed_ && !rolled_back_;
+        }
+
+        [[nodiscard]] bool is_committed() const noexcept {
+            return committed_;
+        }
+
+        [[nodiscard]] bool is_rolled_back() const noexcept {
+            return rolled_back_;
+        }
+
+        // Get underlying connection
+        [[nodiscard]] database_connection& connection() noexcept {
+            return *conn_;
+        }
+
+    private:
+        explicit async_transaction(database_connection& conn) noexcept : conn_(&conn) {}
+
+        void check_active() const {
+            if (!is_active()) {
+                throw database_error{"Transaction already finalized"};
+            }
+        }
+
+        database_connection* conn_;
+        bool committed_ = false;
+        bool rolled_back_ = false;
+    };
+
+    // Coroutine counterpart of with_transaction
+    // func(txn) returns an awaitable. The transaction commits when it
+    // completes and rolls back when it throws; the exception is rethrown.
+    template<typename Func>
+    requires std::invocable<Func, async_transaction&>
+    auto async_with_transaction(
+        database_connection& conn,
+        Func func,
+        isolation_level level = isolation_level::read_committed) -> std::invoke_result_t<Func, async_transaction&> {
+        
+        auto txn = co_await async_transaction::begin(conn, level);
+        std::exception_ptr error;
+        try {
+            if constexpr (std::is_void_v<typename std::invoke_result_t<Func, async_transaction&>::value_type>) {
+                co_await func(txn);
+                co_await txn.async_commit();
+                co_return;
+            } else {
+                auto result = co_await func(txn);
+                co_await txn.async_commit();
+                co_return result;
+            }
+        } catch (...) {
+            error = std::current_exception();
+        }
+        // No co_await inside a handler: roll back once out of it
+        if (txn.is_active()) {
+            try {
+                co_await txn.async_rollback();
+            } catch (...) {
+                // The original error is the one worth reporting
+            }
+        }
+        std::rethrow_exception(error);
+    }
+
+    // async_with_transaction on a connection acquired from a pool
+    // (database_pool, sharded_pool, ...) and returned once it completes
+    template<typename Pool, typename Func>
+    requires requires(Pool& pool) { pool.async_acquire(); } && std::invocable<Func, async_transaction&>
+    auto async_with_transaction(
+        Pool& pool,
+        Func func,
+        isolation_level level = isolation_level::read_committed) -> std::invoke_result_t<Func, async_transaction&> {
+        
+        auto conn = co_await pool.async_acquire();
+        co_return co_await async_with_transaction(*conn, std::move(func), level);
+    }
+
 } // namespace fenrir
\ No newline at end of file
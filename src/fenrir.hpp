@@ -6,9 +6,16 @@
  * A header-only library providing:
  * - RAII resource management
  * - Type-safe query execution
- * - Transaction support with savepoints
- * - Thread-safe connection pooling
+ * - Transaction support with savepoints, blocking or coroutine-native
+ * - Thread-safe connection pooling, sharded per io_context
+ * - Read/write routing across a primary and lag-checked replicas
+ * - Pool telemetry with latency histograms and Prometheus export
+ * - Adaptive concurrency limit driven by measured round trips
+ * - Circuit breaker that fails acquires fast during outages
+ * - SQLSTATE-based retries with jittered backoff
+ * - In-process session multiplexing over a few pipelined connections
  * - Stored procedure wrappers
+ * - EXPLAIN capture with plan assertions
  * - C++20 features: concepts, std::expected, std::optional, std::format
  * 
  * Usage:
@@ -41,8 +48,16 @@
 // Core components
 #include "database_connection.hpp"
 #include "database_query.hpp"
+#include "database_explain.hpp"
 #include "database_transaction.hpp"
+#include "database_pool_metrics.hpp"
+#include "database_concurrency_limit.hpp"
+#include "database_circuit_breaker.hpp"
+#include "database_retry.hpp"
 #include "database_pool.hpp"
+#include "database_sharded_pool.hpp"
+#include "database_routing_pool.hpp"
+#include "database_multiplexer.hpp"
 #include "database_stored_procedure.hpp"
 
 // Version information
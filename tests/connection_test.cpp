@@ -121,6 +121,20 @@ TEST_CASE("database_connection - Parameterized Queries", "[connection]") {
         REQUIRE(result != nullptr);
         PQclear(result);
     }
+    
+    SECTION("Containers bind as array parameters") {
+        PQclear(conn.execute("INSERT INTO test_products (name, price) VALUES ('a', 1), ('b', 2), ('c', 3)"));
+        
+        std::vector<std::string> names{"a", "c", "missing"};
+        query_result by_name(conn.execute_params(
+            "SELECT COUNT(*) FROM test_products WHERE name = ANY($1::text[])", names));
+        REQUIRE(by_name.get<int>(0, 0).value() == 2);
+        
+        std::vector<int> ids{1, 2};
+        query_result by_id(conn.execute_params(
+            "SELECT COUNT(*) FROM test_products WHERE id = ANY($1::int[])", std::span<const int>(ids)));
+        REQUIRE(by_id.get<int>(0, 0).value() == 2);
+    }
 }
 
 TEST_CASE("database_connection - Connection Info", "[connection]") {
@@ -159,6 +173,69 @@ TEST_CASE("database_connection - Error Handling", "[connection]") {
     }
 }
 
+TEST_CASE("database_connection - Pipeline", "[connection][pipeline]") {
+    database_connection conn(TEST_CONNECTION_STRING);
+    
+    auto result = conn.execute("CREATE TEMP TABLE pipeline_test (id INT PRIMARY KEY, name TEXT)");
+    PQclear(result);
+    
+    SECTION("Queued statements return results in order") {
+        database_pipeline pipeline(conn);
+        pipeline.send_params("INSERT INTO pipeline_test (id, name) VALUES ($1, $2)", 1, "Alice");
+        pipeline.send_params("INSERT INTO pipeline_test (id, name) VALUES ($1, $2)", 2, "Bob");
+        pipeline.send("SELECT name FROM pipeline_test ORDER BY id");
+        REQUIRE(pipeline.pending() == 3);
+        
+        auto results = pipeline.sync();
+        REQUIRE(results.size() == 3);
+        REQUIRE(results[0].affected_rows() == 1);
+        REQUIRE(results[2].row_count() == 2);
+        REQUIRE(results[2].get<std::string>(1, 0).value() == "Bob");
+        REQUIRE(pipeline.pending() == 0);
+    }
+    
+    SECTION("Error aborts the rest of the pipeline") {
+        {
+            database_pipeline pipeline(conn);
+            pipeline.send_params("INSERT INTO pipeline_test (id, name) VALUES ($1, $2)", 1, "Alice");
+            pipeline.send_params("INSERT INTO pipeline_test (id, name) VALUES ($1, $2)", 1, "Duplicate");
+            pipeline.send_params("INSERT INTO pipeline_test (id, name) VALUES ($1, $2)", 2, "Bob");
+            REQUIRE_THROWS_AS(pipeline.sync(), database_error);
+        }
+        
+        // The implicit transaction was rolled back and the connection is usable
+        query_result qr(conn.execute("SELECT COUNT(*) FROM pipeline_test"));
+        REQUIRE(qr.get<int>(0, 0).value() == 0);
+    }
+    
+    SECTION("Pipelined prepare is remembered by the connection") {
+        database_pipeline pipeline(conn);
+        pipeline.send_prepare("pipeline_insert", "INSERT INTO pipeline_test (id, name) VALUES ($1, $2)");
+        auto results = pipeline.sync();
+        REQUIRE(results.empty());
+        REQUIRE(conn.is_prepared("pipeline_insert"));
+    }
+    
+    SECTION("Async sync waits for results without blocking") {
+        boost::asio::io_context ioc;
+        size_t rows = 0;
+        auto async_test = [&]() -> boost::asio::awaitable<void> {
+            database_pipeline pipeline(conn);
+            pipeline.send_params("INSERT INTO pipeline_test (id, name) VALUES ($1, $2)", 1, "Alice");
+            pipeline.send_prepare("pipeline_select", "SELECT name FROM pipeline_test");
+            pipeline.send("SELECT name FROM pipeline_test");
+            auto results = co_await pipeline.async_sync();
+            REQUIRE(results.size() == 2);
+            rows = results[1].row_count();
+        };
+        boost::asio::co_spawn(ioc, async_test(), boost::asio::detached);
+        ioc.run();
+        
+        REQUIRE(rows == 1);
+        REQUIRE(conn.is_prepared("pipeline_select"));
+    }
+}
+
 TEST_CASE("database_connection - Async Operations", "[connection][async]") {
     boost::asio::io_context ioc;
     database_connection conn(TEST_CONNECTION_STRING);
@@ -287,3 +364,42 @@ TEST_CASE("database_connection - Async Operations", "[connection][async]") {
         REQUIRE(count.value() == 2);
     }
 }
+
+TEST_CASE("database_connection - Async Connect", "[connection][async]") {
+    boost::asio::io_context ioc;
+    
+    SECTION("Connects without blocking the io_context") {
+        bool connected = false;
+        
+        auto async_test = [&]() -> boost::asio::awaitable<void> {
+            auto conn = co_await database_connection::async_connect(TEST_CONNECTION_STRING);
+            connected = conn.is_connected();
+        };
+        
+        boost::asio::co_spawn(ioc, async_test(), boost::asio::detached);
+        ioc.run();
+        REQUIRE(connected);
+    }
+    
+    SECTION("Unreachable server fails within the timeout") {
+        std::string error;
+        
+        auto async_test = [&]() -> boost::asio::awaitable<void> {
+            try {
+                // Non-routable address: the TCP handshake never completes (or the
+                // network is reported unreachable straight away)
+                co_await database_connection::async_connect(
+                    "host=10.255.255.1 dbname=testdb", std::chrono::milliseconds{200});
+            } catch (const database_error& e) {
+                error = e.what();
+            }
+        };
+        
+        auto start = std::chrono::steady_clock::now();
+        boost::asio::co_spawn(ioc, async_test(), boost::asio::detached);
+        ioc.run();
+        
+        REQUIRE_THAT(error, ContainsSubstring("Failed to connect"));
+        REQUIRE(std::chrono::steady_clock::now() - start < std::chrono::seconds{2});
+    }
+}
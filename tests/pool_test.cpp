@@ -1,11 +1,14 @@
 #include <catch2/catch_test_macros.hpp>
 #include <catch2/matchers/catch_matchers_string.hpp>
+#include <algorithm>
 #include <thread>
 #include <vector>
 #include <atomic>
 #include <chrono>
 #include <random>
 #include <set>
+#include <mutex>
+#include <string>
 #include "../src/fenrir.hpp"
 
 using namespace fenrir;
@@ -583,6 +586,1048 @@ TEST_CASE("database_pool - Async Operations", "[pool][async]") {
     }
 }
 
+TEST_CASE("database_pool - Slot Handles", "[pool][slots]") {
+    // A handle is two pointers back into the pool; acquiring allocates nothing
+    STATIC_REQUIRE(sizeof(pooled_connection) == 2 * sizeof(void*));
+    
+    database_pool::pool_config config{
+        .connection_string = TEST_CONNECTION_STRING,
+        .min_connections = 2,
+        .max_connections = 4
+    };
+    
+    database_pool pool(config);
+    
+    SECTION("Moved handles return their slot exactly once") {
+        auto conn = pool.acquire();
+        PGconn* handle = conn->native_handle();
+        
+        pooled_connection moved = std::move(conn);
+        REQUIRE_FALSE(conn.valid());
+        REQUIRE(moved->native_handle() == handle);
+        REQUIRE(pool.get_stats().active_connections == 1);
+        
+        moved = pooled_connection{};
+        auto stats = pool.get_stats();
+        REQUIRE(stats.active_connections == 0);
+        REQUIRE(stats.available_connections == stats.total_connections);
+    }
+    
+    SECTION("Waiters are woken by releases from other threads") {
+        std::vector<pooled_connection> held;
+        for (int i = 0; i < 4; ++i) {
+            held.push_back(pool.acquire());
+        }
+        REQUIRE(pool.get_stats().total_connections == 4);
+        
+        std::thread releaser([&held]() {
+            std::this_thread::sleep_for(50ms);
+            held.pop_back();
+        });
+        
+        auto start = std::chrono::steady_clock::now();
+        auto conn = pool.acquire(2s);
+        releaser.join();
+        
+        REQUIRE(conn.valid());
+        REQUIRE(std::chrono::steady_clock::now() - start < 1s);
+    }
+    
+    SECTION("Dead connections free their slot") {
+        {
+            auto conn = pool.acquire();
+            conn->close();
+        }
+        auto stats = pool.get_stats();
+        REQUIRE(stats.total_connections == 1);
+        REQUIRE(stats.active_connections == 0);
+        
+        std::vector<pooled_connection> held;
+        for (int i = 0; i < 4; ++i) {
+            held.push_back(pool.acquire());
+        }
+        REQUIRE(pool.get_stats().total_connections == 4);
+    }
+}
+
+TEST_CASE("database_pool - Async Acquire", "[pool][async]") {
+    boost::asio::io_context ioc;
+    
+    database_pool::pool_config config{
+        .connection_string = TEST_CONNECTION_STRING,
+        .min_connections = 1,
+        .max_connections = 1,
+        .io_context = &ioc
+    };
+    
+    database_pool pool(config);
+    
+    SECTION("Acquire without blocking the io_context") {
+        auto async_test = [&]() -> boost::asio::awaitable<void> {
+            auto conn = co_await pool.async_acquire();
+            auto result = co_await conn->async_execute("SELECT 1");
+            REQUIRE(result.row_count() == 1);
+        };
+        
+        boost::asio::co_spawn(ioc, async_test(), boost::asio::detached);
+        ioc.run();
+        REQUIRE(pool.get_stats().active_connections == 0);
+    }
+    
+    SECTION("Waiters are served in FIFO order") {
+        std::vector<int> order;
+        
+        auto holder = [&]() -> boost::asio::awaitable<void> {
+            auto conn = co_await pool.async_acquire();
+            boost::asio::steady_timer timer(ioc, 50ms);
+            co_await timer.async_wait(boost::asio::use_awaitable);
+        };
+        auto waiter = [&](int id) -> boost::asio::awaitable<void> {
+            auto conn = co_await pool.async_acquire(2s);
+            order.push_back(id);
+        };
+        
+        boost::asio::co_spawn(ioc, holder(), boost::asio::detached);
+        for (int i = 0; i < 3; ++i) {
+            boost::asio::co_spawn(ioc, waiter(i), boost::asio::detached);
+        }
+        ioc.run();
+        
+        REQUIRE(order == std::vector<int>{0, 1, 2});
+    }
+    
+    SECTION("Timeout fails the waiter only") {
+        auto held = pool.acquire();
+        bool timed_out = false;
+        
+        auto async_test = [&]() -> boost::asio::awaitable<void> {
+            try {
+                auto conn = co_await pool.async_acquire(50ms);
+            } catch (const database_error& e) {
+                timed_out = std::string(e.what()).find("Timeout") != std::string::npos;
+            }
+        };
+        
+        boost::asio::co_spawn(ioc, async_test(), boost::asio::detached);
+        ioc.run();
+        
+        REQUIRE(timed_out);
+        held = pooled_connection{};
+        REQUIRE(pool.get_stats().available_connections == 1);
+    }
+    
+    SECTION("Release from another thread resumes the waiter") {
+        auto held = pool.acquire();
+        bool acquired = false;
+        
+        std::thread releaser([&held]() {
+            std::this_thread::sleep_for(50ms);
+            held = pooled_connection{};
+        });
+        
+        auto async_test = [&]() -> boost::asio::awaitable<void> {
+            auto conn = co_await pool.async_acquire(2s);
+            acquired = conn.valid();
+        };
+        
+        boost::asio::co_spawn(ioc, async_test(), boost::asio::detached);
+        ioc.run();
+        releaser.join();
+        
+        REQUIRE(acquired);
+    }
+    
+    SECTION("Dead connection is replaced by a non-blocking connect") {
+        {
+            auto conn = pool.acquire();
+            conn->close();
+        }
+        bool connected = false;
+        
+        auto async_test = [&]() -> boost::asio::awaitable<void> {
+            auto conn = co_await pool.async_acquire();
+            connected = conn->is_connected();
+        };
+        
+        boost::asio::co_spawn(ioc, async_test(), boost::asio::detached);
+        ioc.run();
+        
+        REQUIRE(connected);
+        REQUIRE(pool.get_stats().total_connections == 1);
+    }
+}
+
+TEST_CASE("database_pool - Priority Classes", "[pool][priority]") {
+    database_pool::pool_config config{
+        .connection_string = TEST_CONNECTION_STRING,
+        .min_connections = 1,
+        .max_connections = 1,
+        .priority_weights = {1, 0, 0}  // Strict priority
+    };
+    
+    database_pool pool(config);
+    
+    SECTION("Interactive waiters are served before batch waiters") {
+        auto held = pool.acquire();
+        std::mutex order_mutex;
+        std::string order;
+        
+        std::vector<std::thread> threads;
+        auto start_waiter = [&](acquire_priority priority, char tag) {
+            threads.emplace_back([&, priority, tag]() {
+                auto conn = pool.acquire(5s, priority);
+                std::lock_guard<std::mutex> lock(order_mutex);
+                order += tag;
+            });
+            std::this_thread::sleep_for(20ms);  // Queue in a known order
+        };
+        
+        start_waiter(acquire_priority::batch, 'b');
+        start_waiter(acquire_priority::normal, 'n');
+        start_waiter(acquire_priority::interactive, 'i');
+        start_waiter(acquire_priority::interactive, 'i');
+        
+        held = pooled_connection{};
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        
+        REQUIRE(order == "iinb");
+    }
+    
+    SECTION("Expired waiters are shed instead of served") {
+        // The io_context only runs at the end, so the interactive waiter's own
+        // timer cannot take it out of the queue before its deadline passes
+        boost::asio::io_context ioc;
+        auto held = pool.acquire();
+        std::string outcome;
+        
+        auto waiter = [&](std::chrono::milliseconds timeout, acquire_priority priority,
+                          char tag) -> boost::asio::awaitable<void> {
+            try {
+                auto conn = co_await pool.async_acquire(timeout, priority);
+                outcome += tag;
+            } catch (const pool_busy_error&) {
+                outcome += 'x';
+            }
+        };
+        boost::asio::co_spawn(ioc, waiter(10ms, acquire_priority::interactive, 'i'), boost::asio::detached);
+        boost::asio::co_spawn(ioc, waiter(5s, acquire_priority::batch, 'b'), boost::asio::detached);
+        ioc.poll();
+        REQUIRE(pool.get_metrics().waiting == 2);
+        
+        std::this_thread::sleep_for(50ms);
+        held = pooled_connection{};
+        ioc.run();
+        
+        // The expired interactive waiter was turned away; the batch one got the slot
+        REQUIRE(outcome == "xb");
+        REQUIRE(pool.get_stats().available_connections == 1);
+    }
+    
+    SECTION("A new caller does not overtake queued waiters") {
+        boost::asio::io_context ioc;
+        auto held = pool.acquire();
+        bool served = false;
+        
+        auto waiter = [&]() -> boost::asio::awaitable<void> {
+            auto conn = co_await pool.async_acquire(5s, acquire_priority::interactive);
+            served = true;
+        };
+        boost::asio::co_spawn(ioc, waiter(), boost::asio::detached);
+        ioc.poll();
+        
+        // The slot is handed to the queued waiter, not left for try_acquire()
+        held = pooled_connection{};
+        REQUIRE_FALSE(pool.try_acquire().has_value());
+        REQUIRE_THROWS_AS(pool.acquire(20ms, acquire_priority::batch), pool_busy_error);
+        ioc.run();
+        REQUIRE(served);
+    }
+}
+
+TEST_CASE("database_pool - Reuse Policies", "[pool][reuse]") {
+    database_pool::pool_config config{
+        .connection_string = TEST_CONNECTION_STRING,
+        .min_connections = 4,
+        .max_connections = 4
+    };
+    
+    auto backends_used = [](database_pool& pool) {
+        std::set<int> pids;
+        for (int i = 0; i < 20; ++i) {
+            auto conn = pool.acquire();
+            pids.insert(PQbackendPID(conn->native_handle()));
+        }
+        return pids.size();
+    };
+    
+    SECTION("FIFO (the default) spreads requests over every connection") {
+        database_pool pool(config);
+        REQUIRE(backends_used(pool) == 4);
+    }
+    
+    SECTION("LIFO keeps serving the most recently used connection") {
+        config.reuse = reuse_policy::lifo;
+        database_pool pool(config);
+        REQUIRE(backends_used(pool) == 1);
+    }
+    
+    SECTION("Statement affinity prefers the connection that prepared it") {
+        config.reuse = reuse_policy::statement_affinity;
+        database_pool pool(config);
+        
+        int prepared_pid = 0;
+        {
+            std::vector<pooled_connection> held;
+            for (int i = 0; i < 4; ++i) {
+                held.push_back(pool.acquire());
+            }
+            held[2]->prepare("pool_affinity_stmt", "SELECT $1::int");
+            prepared_pid = PQbackendPID(held[2]->native_handle());
+        }
+        
+        for (int i = 0; i < 10; ++i) {
+            auto conn = pool.acquire_for("pool_affinity_stmt");
+            REQUIRE(PQbackendPID(conn->native_handle()) == prepared_pid);
+            REQUIRE(conn->is_prepared("pool_affinity_stmt"));
+        }
+    }
+}
+
+TEST_CASE("database_pool - Background Maintenance", "[pool][maintenance]") {
+    database_pool::pool_config config{
+        .connection_string = TEST_CONNECTION_STRING,
+        .min_connections = 2,
+        .max_connections = 6,
+        .idle_timeout = 1s,
+        .maintenance_interval = 1s
+    };
+    
+    SECTION("Idle connections above min_connections are closed") {
+        database_pool pool(config);
+        {
+            std::vector<pooled_connection> held;
+            for (int i = 0; i < 6; ++i) {
+                held.push_back(pool.acquire());
+            }
+        }
+        REQUIRE(pool.get_stats().total_connections == 6);
+        
+        std::this_thread::sleep_for(2500ms);
+        REQUIRE(pool.get_stats().total_connections == 2);
+    }
+    
+    SECTION("Connections are retired after max_lifetime") {
+        config.idle_timeout = 0s;
+        config.max_lifetime = 1s;
+        database_pool pool(config);
+        
+        int original_pid = 0;
+        {
+            auto conn = pool.acquire();
+            original_pid = PQbackendPID(conn->native_handle());
+        }
+        
+        std::this_thread::sleep_for(2500ms);
+        
+        // Replaced in the background, so the pool is back at min_connections
+        REQUIRE(pool.get_stats().total_connections == 2);
+        std::vector<pooled_connection> held;
+        for (int i = 0; i < 2; ++i) {
+            held.push_back(pool.acquire());
+            REQUIRE(PQbackendPID(held.back()->native_handle()) != original_pid);
+        }
+    }
+    
+    SECTION("Acquires during a maintenance pass do not open connections") {
+        config.min_connections = 4;
+        config.max_connections = 8;
+        config.idle_timeout = 0s;
+        config.maintenance_interval = 0s;
+        database_pool pool(config);
+        
+        // Four callers never need more than the four idle connections, even
+        // while maintain() has them out for checking
+        std::atomic<bool> stop{false};
+        std::vector<std::jthread> workers;
+        for (int i = 0; i < 4; ++i) {
+            workers.emplace_back([&] {
+                while (!stop.load()) {
+                    auto conn = pool.acquire(5s);
+                }
+            });
+        }
+        for (int i = 0; i < 200; ++i) {
+            pool.maintain();
+        }
+        stop = true;
+        workers.clear();
+        
+        REQUIRE(pool.get_stats().total_connections == 4);
+    }
+    
+    SECTION("Shutdown stops the maintenance thread promptly") {
+        config.maintenance_interval = 60s;
+        database_pool pool(config);
+        
+        auto start = std::chrono::steady_clock::now();
+        pool.shutdown();
+        REQUIRE(std::chrono::steady_clock::now() - start < 1s);
+    }
+}
+
+TEST_CASE("database_pool - Unreachable server", "[pool]") {
+    database_pool::pool_config config{
+        .connection_string = "host=10.255.255.1 dbname=testdb",
+        .min_connections = 4,
+        .max_connections = 4,
+        .connection_timeout = 1s
+    };
+    
+    SECTION("Minimum connections time out together") {
+        auto start = std::chrono::steady_clock::now();
+        REQUIRE_THROWS_WITH(database_pool(config), ContainsSubstring("Failed to connect"));
+        
+        // Connects run concurrently, so the wait is one timeout, not four
+        REQUIRE(std::chrono::steady_clock::now() - start < 3s);
+    }
+}
+
+TEST_CASE("database_pool - Try Acquire", "[pool]") {
+    database_pool::pool_config config{
+        .connection_string = TEST_CONNECTION_STRING,
+        .min_connections = 1,
+        .max_connections = 2
+    };
+    
+    database_pool pool(config);
+    
+    SECTION("Never waits for a connection") {
+        auto first = pool.try_acquire(false);  // The idle connection
+        REQUIRE(first.has_value());
+        REQUIRE_FALSE(pool.try_acquire(false).has_value());
+        
+        auto second = pool.try_acquire();  // Opens the second slot
+        REQUIRE(second.has_value());
+        REQUIRE_FALSE(pool.try_acquire().has_value());
+    }
+}
+
+TEST_CASE("database_pool - Metrics", "[pool][metrics]") {
+    database_pool::pool_config config{
+        .connection_string = TEST_CONNECTION_STRING,
+        .min_connections = 1,
+        .max_connections = 1
+    };
+    
+    database_pool pool(config);
+    
+    SECTION("Acquires, hold times and timeouts are recorded") {
+        {
+            auto conn = pool.acquire();
+            std::this_thread::sleep_for(20ms);
+            REQUIRE_THROWS(pool.acquire(10ms));
+        }
+        
+        auto metrics = pool.get_metrics();
+        REQUIRE(metrics.acquires == 1);
+        REQUIRE(metrics.timeouts == 1);
+        REQUIRE(metrics.connects == 1);
+        REQUIRE(metrics.validations == 1);
+        REQUIRE(metrics.connect_latency.count == 1);
+        REQUIRE(metrics.acquire_wait.count == 1);
+        REQUIRE(metrics.hold_time.count == 1);
+        REQUIRE(metrics.hold_time.mean() >= 20ms);
+        REQUIRE(metrics.hold_time.quantile(0.5) >= 20ms);
+    }
+    
+    SECTION("Prometheus export") {
+        { auto conn = pool.acquire(); }
+        
+        auto text = pool.get_metrics().to_prometheus("fenrir_pool", R"(pool="test")");
+        REQUIRE_THAT(text, ContainsSubstring("# TYPE fenrir_pool_acquire_wait_seconds histogram"));
+        REQUIRE_THAT(text, ContainsSubstring(R"(fenrir_pool_acquires_total{pool="test"} 1)"));
+        REQUIRE_THAT(text, ContainsSubstring(R"(fenrir_pool_hold_seconds_bucket{pool="test",le="+Inf"} 1)"));
+        REQUIRE_THAT(text, ContainsSubstring(R"(fenrir_pool_connections_max{pool="test"} 1)"));
+    }
+}
+
+TEST_CASE("database_pool - Connection Hooks", "[pool][hooks]") {
+    std::atomic<int> connected{0};
+    std::atomic<int> returned{0};
+    
+    database_pool::pool_config config{
+        .connection_string = TEST_CONNECTION_STRING,
+        .min_connections = 1,
+        .max_connections = 2,
+        .session_setup = {"SET statement_timeout = '7s'", "SET application_name = 'fenrir_hooks'"},
+        .prepared_statements = {{"hooks_select", "SELECT $1::int"}},
+        .on_connect = [&](database_connection&) { ++connected; },
+        .on_return = [&](database_connection&) { ++returned; return true; }
+    };
+    
+    database_pool pool(config);
+    REQUIRE(connected == 1);
+    
+    SECTION("New connections are set up and have the statements prepared") {
+        auto conn = pool.acquire();
+        REQUIRE(conn->is_prepared("hooks_select"));
+        query_result qr(conn->execute("SHOW statement_timeout"));
+        REQUIRE(qr.get<std::string>(0, 0).value() == "7s");
+    }
+    
+    SECTION("Connections opened by coroutines are set up too") {
+        boost::asio::io_context ioc;
+        bool prepared = false;
+        auto async_test = [&]() -> boost::asio::awaitable<void> {
+            auto first = co_await pool.async_acquire();
+            auto second = co_await pool.async_acquire();  // Opens the second connection
+            prepared = second->is_prepared("hooks_select");
+        };
+        boost::asio::co_spawn(ioc, async_test(), boost::asio::detached);
+        ioc.run();
+        
+        REQUIRE(prepared);
+        REQUIRE(connected == 2);
+    }
+    
+    SECTION("An open transaction is rolled back on return") {
+        {
+            auto conn = pool.acquire();
+            PQclear(conn->execute("BEGIN"));
+            PQclear(conn->execute("SET LOCAL statement_timeout = '1s'"));
+        }
+        REQUIRE(returned == 1);
+        
+        auto conn = pool.acquire();
+        REQUIRE(conn->transaction_status() == PQTRANS_IDLE);
+        query_result qr(conn->execute("SHOW statement_timeout"));
+        REQUIRE(qr.get<std::string>(0, 0).value() == "7s");
+    }
+    
+    SECTION("on_return can refuse a connection") {
+        config.on_return = [](database_connection& conn) {
+            query_result qr(conn.execute("SELECT current_setting('application_name')"));
+            return qr.get<std::string>(0, 0).value() == "fenrir_hooks";
+        };
+        database_pool strict(config);
+        
+        {
+            auto conn = strict.acquire();
+            PQclear(conn->execute("SET application_name = 'changed'"));
+        }
+        REQUIRE(strict.get_stats().total_connections == 0);
+    }
+}
+
+TEST_CASE("database_pool - Adaptive Concurrency Limit", "[pool][limit]") {
+    database_pool::pool_config config{
+        .connection_string = TEST_CONNECTION_STRING,
+        .min_connections = 4,
+        .max_connections = 4,
+        .adaptive_limit = {.enabled = true, .initial_limit = 2}
+    };
+    
+    SECTION("Callers over the limit wait even with idle connections") {
+        database_pool pool(config);
+        REQUIRE(pool.get_metrics().concurrency_limit == 2);
+        
+        auto first = pool.acquire();
+        auto second = pool.acquire();
+        REQUIRE_FALSE(pool.try_acquire().has_value());
+        REQUIRE_THROWS_WITH(pool.acquire(50ms), ContainsSubstring("Timeout"));
+        REQUIRE(pool.get_stats().available_connections == 2);
+    }
+    
+    SECTION("Callers over the limit can be rejected at once") {
+        config.adaptive_limit.reject = true;
+        database_pool pool(config);
+        
+        auto first = pool.acquire();
+        auto second = pool.acquire();
+        auto start = std::chrono::steady_clock::now();
+        REQUIRE_THROWS_WITH(pool.acquire(5s), ContainsSubstring("Concurrency limit reached"));
+        REQUIRE(std::chrono::steady_clock::now() - start < 1s);
+        REQUIRE(pool.get_metrics().rejections == 1);
+    }
+    
+    SECTION("The limit shrinks when round trips slow down") {
+        // Wide tolerance: only the deliberate slowdown below counts, not jitter
+        config.adaptive_limit = {
+            .enabled = true, .initial_limit = 4, .tolerance = 100.0, .smoothing = 1.0, .short_window = 1
+        };
+        database_pool pool(config);
+        
+        // Fast round trips at full concurrency set the no-load baseline
+        for (int i = 0; i < 10; ++i) {
+            std::vector<pooled_connection> held;
+            for (int j = 0; j < 4; ++j) {
+                held.push_back(pool.acquire());
+                PQclear(held.back()->execute("SELECT 1"));
+            }
+        }
+        REQUIRE(pool.get_metrics().concurrency_limit == 4);
+        
+        {
+            std::vector<pooled_connection> held;
+            for (int j = 0; j < 4; ++j) {
+                held.push_back(pool.acquire());
+                PQclear(held.back()->execute("SELECT pg_sleep(0.05)"));
+            }
+        }
+        REQUIRE(pool.get_metrics().concurrency_limit < 4);
+    }
+    
+    SECTION("Holding a connection between queries is not a slow round trip") {
+        config.adaptive_limit = {
+            .enabled = true, .initial_limit = 4, .tolerance = 100.0, .smoothing = 1.0, .short_window = 1
+        };
+        database_pool pool(config);
+        
+        for (int i = 0; i < 10; ++i) {
+            std::vector<pooled_connection> held;
+            for (int j = 0; j < 4; ++j) {
+                held.push_back(pool.acquire());
+                PQclear(held.back()->execute("SELECT 1"));
+            }
+        }
+        
+        {
+            std::vector<pooled_connection> held;
+            for (int j = 0; j < 4; ++j) {
+                held.push_back(pool.acquire());
+                PQclear(held.back()->execute("SELECT 1"));
+            }
+            std::this_thread::sleep_for(50ms);
+        }
+        REQUIRE(pool.get_metrics().concurrency_limit == 4);
+    }
+}
+
+TEST_CASE("database_pool - Circuit Breaker", "[pool][breaker]") {
+    database_pool::pool_config config{
+        .connection_string = "host=127.0.0.1 port=1 dbname=testdb connect_timeout=1",
+        .min_connections = 0,
+        .max_connections = 4,
+        .circuit_breaker = {.enabled = true, .failure_threshold = 2, .open_duration = 200ms, .half_open_probes = 1}
+    };
+    
+    SECTION("Failed connects open the breaker and acquires fail fast") {
+        database_pool pool(config);
+        REQUIRE_THROWS_WITH(pool.acquire(1s), ContainsSubstring("Failed to connect"));
+        REQUIRE(pool.get_metrics().open_circuits == 0);
+        REQUIRE_THROWS_WITH(pool.acquire(1s), ContainsSubstring("Failed to connect"));
+        REQUIRE(pool.get_metrics().open_circuits == 1);
+        
+        auto start = std::chrono::steady_clock::now();
+        REQUIRE_THROWS_WITH(pool.acquire(5s), ContainsSubstring("Circuit breaker open"));
+        REQUIRE_THROWS_WITH(pool.try_acquire(), ContainsSubstring("Circuit breaker open"));
+        REQUIRE(std::chrono::steady_clock::now() - start < 100ms);
+        
+        auto metrics = pool.get_metrics();
+        REQUIRE(metrics.connect_failures == 2);
+        REQUIRE(metrics.breaker_rejections == 2);
+    }
+    
+    SECTION("A failed probe opens the breaker again") {
+        database_pool pool(config);
+        REQUIRE_THROWS(pool.acquire(1s));
+        REQUIRE_THROWS(pool.acquire(1s));
+        
+        std::this_thread::sleep_for(250ms);
+        REQUIRE_THROWS_WITH(pool.acquire(1s), ContainsSubstring("Failed to connect"));
+        REQUIRE_THROWS_WITH(pool.acquire(1s), ContainsSubstring("Circuit breaker open"));
+        REQUIRE(pool.get_metrics().connect_failures == 3);
+    }
+    
+    SECTION("Successful probes close the breaker") {
+        detail::circuit_breaker breaker(config.circuit_breaker);
+        auto now = std::chrono::steady_clock::now();
+        REQUIRE_FALSE(breaker.record_failure(now));
+        REQUIRE(breaker.record_failure(now));
+        REQUIRE_FALSE(breaker.allow());
+        
+        std::this_thread::sleep_for(250ms);
+        REQUIRE(breaker.allow());
+        REQUIRE_FALSE(breaker.allow());  // Only one probe at a time
+        REQUIRE(breaker.state() == circuit_state::half_open);
+        breaker.record_success(std::chrono::steady_clock::now());
+        REQUIRE(breaker.state() == circuit_state::closed);
+        REQUIRE(breaker.allow());
+    }
+}
+
+TEST_CASE("database_pool - Retry Policy", "[pool][retry]") {
+    database_pool::pool_config config{
+        .connection_string = TEST_CONNECTION_STRING,
+        .min_connections = 1,
+        .max_connections = 1
+    };
+    
+    database_pool pool(config);
+    
+    SECTION("Errors are classified by SQLSTATE") {
+        REQUIRE(classify_error("40001") == retry_reason::serialization_failure);
+        REQUIRE(classify_error("40P01") == retry_reason::deadlock);
+        REQUIRE(classify_error("08006") == retry_reason::connection_lost);
+        REQUIRE(classify_error("57P01") == retry_reason::server_unavailable);
+        REQUIRE(classify_error("23505") == retry_reason::none);
+        REQUIRE(classify_error("", false) == retry_reason::connection_lost);
+        REQUIRE(classify_error("", true) == retry_reason::none);
+    }
+    
+    SECTION("Idempotent operations are retried with backoff") {
+        auto conn = pool.acquire();
+        int calls = 0;
+        auto start = std::chrono::steady_clock::now();
+        auto value = conn.execute_with_retry([&](database_connection&) {
+            if (++calls < 3) throw database_error{"could not serialize access", "40001"};
+            return calls;
+        }, retry_policy{.idempotent = true, .initial_backoff = 20ms});
+        
+        REQUIRE(value == 3);
+        REQUIRE(std::chrono::steady_clock::now() - start >= 10ms + 20ms);
+        REQUIRE(pool.get_metrics().retries == 2);
+    }
+    
+    SECTION("Other operations are not retried") {
+        auto conn = pool.acquire();
+        int calls = 0;
+        REQUIRE_THROWS_WITH(conn.execute_with_retry([&](database_connection&) -> int {
+            ++calls;
+            throw database_error{"could not serialize access", "40001"};
+        }), ContainsSubstring("serialize"));
+        REQUIRE(calls == 1);
+        
+        REQUIRE_THROWS(conn.execute_with_retry([&](database_connection&) -> int {
+            ++calls;
+            throw database_error{"duplicate key", "23505"};
+        }, retry_policy::for_idempotent()));
+        REQUIRE(calls == 2);
+    }
+    
+    SECTION("Without a policy, lost connections are retried as before") {
+        auto conn = pool.acquire();
+        int calls = 0;
+        auto value = conn.execute_with_retry([&](database_connection&) {
+            if (++calls < 3) throw database_error{"server closed the connection", "08006"};
+            return calls;
+        });
+        REQUIRE(value == 3);
+        
+        calls = 0;
+        REQUIRE_THROWS(conn.execute_with_retry([&](database_connection&) -> int {
+            ++calls;
+            throw database_error{"server closed the connection", "08006"};
+        }, 1));
+        REQUIRE(calls == 2);
+    }
+    
+    SECTION("Retries stop at max_attempts and the deadline") {
+        auto conn = pool.acquire();
+        int calls = 0;
+        auto failing = [&](database_connection&) -> int {
+            ++calls;
+            throw database_error{"deadlock detected", "40P01"};
+        };
+        
+        REQUIRE_THROWS(conn.execute_with_retry(failing, retry_policy{.idempotent = true, .max_attempts = 4}));
+        REQUIRE(calls == 4);
+        
+        calls = 0;
+        REQUIRE_THROWS(conn.execute_with_retry(failing, retry_policy{
+            .idempotent = true, .max_attempts = 100, .initial_backoff = 40ms, .deadline = 100ms}));
+        REQUIRE(calls < 5);
+    }
+}
+
+TEST_CASE("database_pool - Async Retry", "[pool][retry][async]") {
+    boost::asio::io_context ioc;
+    
+    database_pool::pool_config config{
+        .connection_string = TEST_CONNECTION_STRING,
+        .min_connections = 1,
+        .max_connections = 1,
+        .io_context = &ioc
+    };
+    
+    database_pool pool(config);
+    
+    SECTION("Backoff waits on a timer") {
+        int calls = 0;
+        std::size_t rows = 0;
+        auto async_test = [&]() -> boost::asio::awaitable<void> {
+            auto conn = co_await pool.async_acquire();
+            auto result = co_await conn.async_execute_with_retry(
+                [&](database_connection& c) -> boost::asio::awaitable<query_result> {
+                    if (++calls < 2) throw database_error{"terminating connection", "57P01"};
+                    co_return co_await c.async_execute("SELECT 1");
+                },
+                retry_policy::for_idempotent());
+            rows = result.row_count();
+        };
+        
+        boost::asio::co_spawn(ioc, async_test(), boost::asio::detached);
+        ioc.run();
+        REQUIRE(calls == 2);
+        REQUIRE(rows == 1);
+    }
+}
+
+TEST_CASE("sharded_pool - Shards", "[pool][sharded]") {
+    database_pool::pool_config config{
+        .connection_string = TEST_CONNECTION_STRING,
+        .min_connections = 4,
+        .max_connections = 8
+    };
+    
+    SECTION("Connection limits are split across the shards") {
+        sharded_pool pool(config, 4);
+        REQUIRE(pool.shard_count() == 4);
+        for (size_t i = 0; i < pool.shard_count(); ++i) {
+            REQUIRE(pool.shard(i).get_stats().total_connections == 1);
+            REQUIRE(pool.shard(i).get_stats().max_connections == 2);
+        }
+        REQUIRE(pool.get_stats().max_connections == 8);
+    }
+    
+    SECTION("Without work stealing a thread stays on its own shard") {
+        sharded_pool pool(config, 4);
+        
+        std::vector<pooled_connection> held;
+        held.push_back(pool.acquire(1s));
+        held.push_back(pool.acquire(1s));
+        REQUIRE_THROWS_AS(pool.acquire(50ms), pool_busy_error);
+        REQUIRE(pool.get_stats().active_connections == 2);
+    }
+    
+    SECTION("With work stealing, sibling connections are used before new ones") {
+        sharded_pool pool(config, 4, sharded_pool::options{.work_stealing = true});
+        
+        // The home shard's idle connection and the three siblings' come first
+        std::vector<pooled_connection> held;
+        for (int i = 0; i < 4; ++i) {
+            held.push_back(pool.acquire(1s));
+        }
+        REQUIRE(pool.get_stats().total_connections == 4);
+        
+        // One thread can use the whole pool once its own shard is exhausted
+        for (int i = 0; i < 4; ++i) {
+            held.push_back(pool.acquire(1s));
+        }
+        REQUIRE(pool.get_stats().active_connections == 8);
+        REQUIRE_THROWS_WITH(pool.acquire(50ms), ContainsSubstring("Timeout"));
+    }
+    
+    SECTION("max_connections below the shard count is rejected") {
+        config.min_connections = 1;
+        config.max_connections = 2;
+        REQUIRE_THROWS_AS(sharded_pool(config, 4), database_error);
+    }
+    
+    SECTION("Coroutines acquire from their own io_context's shard") {
+        boost::asio::io_context first;
+        boost::asio::io_context second;
+        sharded_pool pool(config, std::vector<boost::asio::io_context*>{&first, &second});
+        
+        boost::asio::io_context* bound = nullptr;
+        auto async_test = [&]() -> boost::asio::awaitable<void> {
+            auto conn = co_await pool.async_acquire();
+            bound = conn->get_io_context();
+            auto result = co_await conn->async_execute("SELECT 1");
+            REQUIRE(result.row_count() == 1);
+        };
+        
+        boost::asio::co_spawn(second, async_test(), boost::asio::detached);
+        second.run();
+        REQUIRE(bound == &second);
+        
+        boost::asio::co_spawn(first, async_test(), boost::asio::detached);
+        first.run();
+        REQUIRE(bound == &first);
+    }
+}
+
+TEST_CASE("routing_pool - Read/Write Split", "[pool][routing]") {
+    // The test server stands in for both hosts; not being in recovery, it
+    // reports a replay lag of 0
+    routing_pool::routing_config config{
+        .primary = {
+            .connection_string = TEST_CONNECTION_STRING,
+            .min_connections = 1,
+            .max_connections = 4
+        },
+        .replicas = {{
+            .connection_string = TEST_CONNECTION_STRING,
+            .min_connections = 1,
+            .max_connections = 4
+        }},
+        .lag_check_interval = 0ms
+    };
+    
+    SECTION("Reads go to the replica, writes to the primary") {
+        routing_pool pool(config);
+        auto status = pool.status(0);
+        REQUIRE(status.healthy);
+        REQUIRE(status.lag == 0ms);
+        
+        {
+            auto reader = pool.acquire(access_mode::read_only);
+            REQUIRE(pool.replica(0).get_stats().active_connections == 1);
+            REQUIRE(pool.primary().get_stats().active_connections == 0);
+        }
+        {
+            auto writer = pool.acquire(access_mode::read_write);
+            REQUIRE(pool.primary().get_stats().active_connections == 1);
+            REQUIRE(pool.replica(0).get_stats().active_connections == 0);
+        }
+    }
+    
+    SECTION("Reads fall back to the primary when no replica qualifies") {
+        config.max_replica_lag = -1ms;  // Even a lag of 0 is too much
+        routing_pool pool(config);
+        
+        auto reader = pool.acquire(access_mode::read_only);
+        REQUIRE(pool.primary().get_stats().active_connections == 1);
+        REQUIRE(pool.replica(0).get_stats().active_connections == 0);
+    }
+    
+    SECTION("An unreachable replica is unhealthy and serves no reads") {
+        config.replicas[0].connection_string = "host=127.0.0.1 port=1 connect_timeout=1";
+        routing_pool pool(config);
+        REQUIRE_FALSE(pool.status(0).healthy);
+        
+        auto reader = pool.acquire(access_mode::read_only, 1s);
+        REQUIRE(pool.primary().get_stats().active_connections == 1);
+    }
+    
+    SECTION("A saturated replica stays healthy and the primary gets the remaining time") {
+        config.replicas[0].max_connections = 1;
+        routing_pool pool(config);
+        auto held = pool.replica(0).acquire();
+        
+        // Half the timeout is spent on the replica, not all of it
+        auto start = std::chrono::steady_clock::now();
+        auto reader = pool.acquire(access_mode::read_only, 400ms);
+        REQUIRE(std::chrono::steady_clock::now() - start < 350ms);
+        REQUIRE(pool.primary().get_stats().active_connections == 1);
+        REQUIRE(pool.status(0).healthy);
+        
+        auto writer = pool.acquire(access_mode::read_write);
+        REQUIRE_THROWS_AS(pool.replica(0).acquire(10ms), pool_busy_error);
+    }
+    
+    SECTION("The primary fallback has time to wait for a connection") {
+        config.primary.max_connections = 1;
+        config.replicas[0].max_connections = 1;
+        routing_pool pool(config);
+        auto replica_held = pool.replica(0).acquire();
+        
+        // The primary's only connection is freed after the replica's share of
+        // the timeout ran out, but well before the whole timeout
+        std::thread releaser([primary_held = pool.primary().acquire()]() mutable {
+            std::this_thread::sleep_for(700ms);
+            primary_held = pooled_connection{};
+        });
+        auto reader = pool.acquire(access_mode::read_only, 1s);
+        releaser.join();
+        REQUIRE(pool.primary().get_stats().active_connections == 1);
+    }
+    
+    SECTION("Read-only transactions reject writes") {
+        routing_pool pool(config);
+        
+        auto count = pool.with_transaction(access_mode::read_only, [](database_transaction& txn) {
+            return query_result(txn.execute("SELECT 1")).row_count();
+        });
+        REQUIRE(count == 1);
+        
+        REQUIRE_THROWS_AS(pool.with_transaction(access_mode::read_only, [](database_transaction& txn) {
+            (void)txn.execute("CREATE TABLE routing_test (id INT)");
+        }), database_error);
+    }
+}
+
+TEST_CASE("session_multiplexer - Shared Connections", "[pool][multiplexer]") {
+    boost::asio::io_context ioc;
+    
+    multiplexer_config config{
+        .connection_string = TEST_CONNECTION_STRING,
+        .connections = 2,
+        .io_context = &ioc
+    };
+    
+    SECTION("Many coroutines share two connections") {
+        session_multiplexer mux(config);
+        std::vector<int> values;
+        
+        auto query = [&](int i) -> boost::asio::awaitable<void> {
+            auto result = co_await mux.async_execute_params("SELECT $1::int", i);
+            values.push_back(*result.get<int>(0, 0));
+            if (values.size() == 50) mux.shutdown();
+        };
+        for (int i = 0; i < 50; ++i) {
+            boost::asio::co_spawn(ioc, query(i), boost::asio::detached);
+        }
+        ioc.run();
+        
+        std::ranges::sort(values);
+        REQUIRE(values.size() == 50);
+        REQUIRE(values.front() == 0);
+        REQUIRE(values.back() == 49);
+    }
+    
+    SECTION("A failing statement does not affect its neighbours") {
+        session_multiplexer mux(config);
+        int ok = 0;
+        bool failed = false;
+        
+        auto run = [&]() -> boost::asio::awaitable<void> {
+            (void)co_await mux.async_execute("SELECT 1");
+            ++ok;
+            try {
+                (void)co_await mux.async_execute("SELECT * FROM fenrir_no_such_table");
+            } catch (const database_error& e) {
+                failed = e.sql_state == "42P01";
+            }
+            (void)co_await mux.async_execute("SELECT 1");
+            ++ok;
+            mux.shutdown();
+        };
+        boost::asio::co_spawn(ioc, run(), boost::asio::detached);
+        ioc.run();
+        
+        REQUIRE(failed);
+        REQUIRE(ok == 2);
+    }
+    
+    SECTION("Transactions pin one connection until commit") {
+        config.connections = 1;
+        session_multiplexer mux(config);
+        std::string seen;
+        std::string after;
+        
+        auto run = [&]() -> boost::asio::awaitable<void> {
+            auto txn = co_await mux.async_begin();
+            (void)co_await txn.async_execute("SELECT set_config('fenrir.mux_test', 'pinned', true)");
+            auto result = co_await txn.async_execute("SELECT current_setting('fenrir.mux_test')");
+            seen = *result.get<std::string>(0, 0);
+            co_await txn.async_commit();
+            
+            // The setting was local to the transaction
+            auto outside = co_await mux.async_execute("SELECT current_setting('fenrir.mux_test', true)");
+            after = outside.get<std::string>(0, 0).value_or("");
+            mux.shutdown();
+        };
+        boost::asio::co_spawn(ioc, run(), boost::asio::detached);
+        ioc.run();
+        
+        REQUIRE(seen == "pinned");
+        REQUIRE(after.empty());
+    }
+}
+
 TEST_CASE("database_pool - Pool without async support", "[pool]") {
     // Pool without io_context - connections don't support async
     database_pool::pool_config config{
@@ -1,5 +1,11 @@
 #include "../src/database_query.hpp"
 #include <iostream>
+#include <utility>
+
+template<typename Query>
+concept keyset_paginable = requires(Query query) { query.keyset_paginate({"id"}, 10); };
+
+using select_from = fenrir::typed_query_builder<fenrir::query_state<fenrir::select_query_tag, true>>;
 
 // Just test that it compiles
 int main() {
@@ -11,6 +17,17 @@ int main() {
     static_assert(fenrir::UpdateQuery<fenrir::query_state<fenrir::update_query_tag, false, false, false, false>>);
     static_assert(fenrir::DeleteQuery<fenrir::query_state<fenrir::delete_query_tag, false, false, false, false>>);
     
+    // keyset_paginate() supplies its own ORDER BY and LIMIT
+    static_assert(keyset_paginable<select_from>);
+    static_assert(keyset_paginable<decltype(std::declval<select_from>().where("a = 1"))>);
+    static_assert(!keyset_paginable<decltype(std::declval<select_from>().order_by("id"))>);
+    static_assert(!keyset_paginable<decltype(std::declval<select_from>().limit(10))>);
+    static_assert(!keyset_paginable<decltype(std::declval<select_from>().offset(10))>);
+    
+    // ...and its key predicate cannot follow GROUP BY or HAVING
+    static_assert(!keyset_paginable<decltype(std::declval<select_from>().group_by("a"))>);
+    static_assert(!keyset_paginable<decltype(std::declval<select_from>().group_by("a").having("count(*) > 1"))>);
+    
     std::cout << "All concepts validated at compile time!\n";
     
     return 0;
@@ -550,3 +550,423 @@ TEST_CASE("database_query - Error Handling", "[query][error]") {
         );
     }
 }
+
+TEST_CASE("typed_query_builder - Prepared Statements", "[query][prepared]") {
+    database_connection conn(TEST_CONNECTION_STRING);
+    
+    auto create_result = conn.execute("CREATE TEMP TABLE test_prepared (id SERIAL, name TEXT, score INT, ratio FLOAT8)");
+    PQclear(create_result);
+    
+    auto insert_result = conn.execute(
+        "INSERT INTO test_prepared (name, score, ratio) VALUES "
+        "('Alice', 90, 0.5), ('Bob', 75, 1.5), ('Charlie', 60, NULL)"
+    );
+    PQclear(insert_result);
+    
+    SECTION("Execute with typed binary parameters") {
+        auto stmt = typed_query_builder(conn)
+            .select("name, score")
+            .from("test_prepared")
+            .where("score > $1")
+            .order_by("score", false)
+            .prepare<int>();
+        
+        auto result = stmt(70);
+        REQUIRE(result.row_count() == 2);
+        REQUIRE(result.get<std::string>(0, 0).value() == "Alice");
+        
+        // Re-execution reuses the server-side statement
+        auto again = stmt(80);
+        REQUIRE(again.row_count() == 1);
+        REQUIRE(conn.is_prepared(stmt.name()));
+    }
+    
+    SECTION("Result metadata is described once") {
+        auto stmt = typed_query_builder(conn)
+            .select("id, name, score")
+            .from("test_prepared")
+            .where("name = $1")
+            .prepare<std::string>();
+        
+        REQUIRE(stmt.columns().size() == 3);
+        REQUIRE(stmt.column_index("score").value() == 2);
+        REQUIRE_FALSE(stmt.column_index("missing").has_value());
+        
+        auto result = stmt("Bob");
+        REQUIRE(result.get<int>(0, *stmt.column_index("score")).value() == 75);
+    }
+    
+    SECTION("Optional parameters are sent as NULL") {
+        auto stmt = typed_query_builder(conn)
+            .insert_into("test_prepared", "name, score, ratio")
+            .values("$1, $2, $3")
+            .returning("id")
+            .prepare<std::string, int, std::optional<double>>();
+        
+        auto result = stmt("Dave", 50, std::optional<double>{});
+        REQUIRE(result.row_count() == 1);
+        
+        auto check = conn.execute("SELECT COUNT(*) FROM test_prepared WHERE ratio IS NULL");
+        query_result qr(check);
+        REQUIRE(qr.get<int>(0, 0).value() == 2);
+    }
+    
+    SECTION("Containers are sent as binary arrays") {
+        auto stmt = typed_query_builder(conn)
+            .select("name")
+            .from("test_prepared")
+            .where("score = ANY($1)")
+            .order_by("name")
+            .prepare<std::vector<int>>();
+        
+        auto result = stmt(std::vector<int>{90, 60, 1});
+        REQUIRE(result.row_count() == 2);
+        REQUIRE(result.get<std::string>(0, 0).value() == "Alice");
+        REQUIRE(result.get<std::string>(1, 0).value() == "Charlie");
+        
+        REQUIRE(stmt(std::vector<int>{}).row_count() == 0);
+        
+        auto by_name = typed_query_builder(conn)
+            .select("score")
+            .from("test_prepared")
+            .where("name = ANY($1::text[])")
+            .prepare<std::vector<std::string>>();
+        
+        REQUIRE(by_name(std::vector<std::string>{"Bob", "Nobody"}).row_count() == 1);
+    }
+    
+    SECTION("Declared arity must match the statement") {
+        REQUIRE_THROWS_AS(
+            typed_query_builder(conn)
+                .select("*")
+                .from("test_prepared")
+                .where("score > $1 AND name = $2")
+                .prepare<int>(),
+            database_error
+        );
+    }
+    
+    SECTION("Pool-bound statements prepare lazily per connection") {
+        database_pool::pool_config config{
+            .connection_string = TEST_CONNECTION_STRING,
+            .min_connections = 2,
+            .max_connections = 2
+        };
+        database_pool pool(config);
+        
+        auto stmt = typed_query_builder(conn)
+            .select("$1::int + $2::int")
+            .from("(SELECT 1) AS one")
+            .prepare<int, int>(pool);
+        
+        for (int i = 0; i < 4; ++i) {
+            auto result = stmt(i, 10);
+            REQUIRE(result.get<int>(0, 0).value() == i + 10);
+        }
+    }
+    
+    SECTION("Pool-bound async calls wait for a connection without blocking") {
+        boost::asio::io_context ioc;
+        database_pool::pool_config config{
+            .connection_string = TEST_CONNECTION_STRING,
+            .min_connections = 1,
+            .max_connections = 1,
+            .io_context = &ioc
+        };
+        database_pool pool(config);
+        
+        auto stmt = typed_query_builder(conn)
+            .select("$1::int + $2::int")
+            .from("(SELECT 1) AS one")
+            .prepare<int, int>(pool);
+        
+        // The holder keeps the only connection while the callers queue on the
+        // same thread; a blocking acquire would never see it returned
+        int completed = 0;
+        auto holder = [&]() -> boost::asio::awaitable<void> {
+            auto held = co_await pool.async_acquire();
+            boost::asio::steady_timer timer(ioc, std::chrono::milliseconds(50));
+            co_await timer.async_wait(boost::asio::use_awaitable);
+        };
+        auto caller = [&](int i) -> boost::asio::awaitable<void> {
+            auto result = co_await stmt.execute_async(i, 10);
+            REQUIRE(result.get<int>(0, 0).value() == i + 10);
+            ++completed;
+        };
+        boost::asio::co_spawn(ioc, holder(), boost::asio::detached);
+        for (int i = 0; i < 3; ++i) {
+            boost::asio::co_spawn(ioc, caller(i), boost::asio::detached);
+        }
+        ioc.run();
+        
+        REQUIRE(completed == 3);
+    }
+}
+
+TEST_CASE("typed_query_builder - Batched INSERT", "[query][batch]") {
+    database_connection conn(TEST_CONNECTION_STRING);
+    
+    auto create_result = conn.execute("CREATE TEMP TABLE test_batch (id INT, name TEXT, score FLOAT8)");
+    PQclear(create_result);
+    
+    std::vector<std::tuple<int, std::string, std::optional<double>>> rows;
+    for (int i = 0; i < 2500; ++i) {
+        rows.emplace_back(i, std::format("user_{}", i),
+                          i % 10 == 0 ? std::nullopt : std::optional<double>(i * 0.5));
+    }
+    
+    auto count_rows = [&conn]() {
+        query_result qr(conn.execute("SELECT COUNT(*), COUNT(score) FROM test_batch"));
+        return std::pair{qr.get<int>(0, 0).value(), qr.get<int>(0, 1).value()};
+    };
+    
+    SECTION("Multi-row VALUES chunks") {
+        auto batch = typed_query_builder(conn)
+            .insert_into("test_batch", "id, name, score")
+            .values_range(rows)
+            .chunk_rows(1000);
+        
+        REQUIRE(batch.rows_per_chunk() == 1000);
+        REQUIRE(batch.execute() == 2500);
+        REQUIRE(count_rows() == std::pair{2500, 2250});
+    }
+    
+    SECTION("Chunks stay under the bind parameter limit") {
+        auto batch = typed_query_builder(conn)
+            .insert_into("test_batch", "id, name, score")
+            .values_range(rows)
+            .chunk_rows(100000);
+        
+        REQUIRE(batch.rows_per_chunk() * 3 <= 65535);
+        REQUIRE(batch.execute() == 2500);
+    }
+    
+    SECTION("unnest arrays") {
+        auto batch = typed_query_builder(conn)
+            .insert_into("test_batch", "id, name, score")
+            .values_range(rows)
+            .style(batch_insert_style::unnest)
+            .chunk_rows(1000);
+        
+        REQUIRE_THAT(batch.chunk_sql(1000), ContainsSubstring("unnest($1::int4[], $2::text[], $3::float8[])"));
+        REQUIRE(batch.execute() == 2500);
+        REQUIRE(count_rows() == std::pair{2500, 2250});
+    }
+    
+    SECTION("Pipelined chunks") {
+        auto inserted = typed_query_builder(conn)
+            .insert_into("test_batch", "id, name, score")
+            .values_range(rows)
+            .chunk_rows(300)
+            .pipelined()
+            .execute();
+        
+        REQUIRE(inserted == 2500);
+        REQUIRE(count_rows() == std::pair{2500, 2250});
+    }
+    
+    SECTION("Structs via projection") {
+        struct person {
+            int id;
+            std::string name;
+        };
+        std::vector<person> people{{1, "Alice"}, {2, "O'Brien \"Bob\""}};
+        
+        auto inserted = typed_query_builder(conn)
+            .insert_into("test_batch", "id, name")
+            .values_range(people, [](const person& p) { return std::tie(p.id, p.name); })
+            .style(batch_insert_style::unnest)
+            .execute();
+        
+        REQUIRE(inserted == 2);
+        query_result qr(conn.execute("SELECT name FROM test_batch WHERE id = 2"));
+        REQUIRE(qr.get<std::string>(0, 0).value() == "O'Brien \"Bob\"");
+    }
+}
+
+TEST_CASE("typed_query_builder - Keyset Pagination", "[query][pagination]") {
+    database_connection conn(TEST_CONNECTION_STRING);
+    
+    auto create_result = conn.execute("CREATE TEMP TABLE test_pages (id INT PRIMARY KEY, grp INT, name TEXT)");
+    PQclear(create_result);
+    
+    auto insert_result = conn.execute(
+        "INSERT INTO test_pages SELECT g, g % 3, 'row_' || g FROM generate_series(1, 95) AS g"
+    );
+    PQclear(insert_result);
+    
+    SECTION("Iterate all pages as a range") {
+        auto pager = typed_query_builder(conn)
+            .select("id, name")
+            .from("test_pages")
+            .keyset_paginate({"id"}, 10);
+        
+        int pages = 0;
+        int rows = 0;
+        int previous_id = 0;
+        for (const auto& page : pager) {
+            ++pages;
+            for (int row : page) {
+                int id = page.get<int>(row, "id").value();
+                REQUIRE(id > previous_id);
+                previous_id = id;
+                ++rows;
+            }
+        }
+        
+        REQUIRE(pages == 10);
+        REQUIRE(rows == 95);
+        REQUIRE(pager.done());
+    }
+    
+    SECTION("WHERE parameters and composite keys") {
+        auto pager = typed_query_builder(conn)
+            .select("grp, id")
+            .from("test_pages")
+            .where("grp = $1")
+            .keyset_paginate({"grp", "id"}, 20);
+        pager.with_params(1);
+        
+        REQUIRE_THAT(pager.next_sql(), ContainsSubstring("AND (grp, id) > ($2, $3)"));
+        
+        int rows = 0;
+        while (auto page = pager.next_page()) {
+            rows += page->row_count();
+        }
+        REQUIRE(rows == 32);
+    }
+    
+    SECTION("Parameters bound fluently survive the copy out of the temporary") {
+        std::string prefix = "row_";
+        auto pager = typed_query_builder(conn)
+            .select("grp, id")
+            .from("test_pages")
+            .where("grp = $1 AND name LIKE $2 || '%'")
+            .keyset_paginate({"id"}, 10)
+            .with_params(2, prefix);
+        
+        int rows = 0;
+        while (auto page = pager.next_page()) {
+            for (int row : *page) {
+                REQUIRE(page->get<int>(row, "grp").value() == 2);
+            }
+            rows += page->row_count();
+        }
+        REQUIRE(rows == 32);
+    }
+    
+    SECTION("An OR in the WHERE clause stays under the key predicate") {
+        auto pager = typed_query_builder(conn)
+            .select("id")
+            .from("test_pages")
+            .where("grp = 0 OR grp = 1")
+            .keyset_paginate({"id"}, 10);
+        
+        int rows = 0;
+        int pages = 0;
+        while (auto page = pager.next_page()) {
+            rows += page->row_count();
+            REQUIRE(++pages <= 7);
+        }
+        REQUIRE(rows == 63);
+    }
+    
+    SECTION("Resume from a carried key") {
+        auto first = typed_query_builder(conn)
+            .select("id")
+            .from("test_pages")
+            .keyset_paginate({"id"}, 25);
+        auto page = first.next_page();
+        REQUIRE(page->row_count() == 25);
+        auto cursor = first.last_key();
+        REQUIRE(cursor.front().value() == "25");
+        
+        auto resumed = typed_query_builder(conn)
+            .select("id")
+            .from("test_pages")
+            .keyset_paginate({"id"}, 25);
+        resumed.resume_after(cursor);
+        auto next = resumed.next_page();
+        REQUIRE(next->get<int>(0, 0).value() == 26);
+    }
+    
+    SECTION("Descending order") {
+        auto pager = typed_query_builder(conn)
+            .select("id")
+            .from("test_pages")
+            .keyset_paginate({"id"}, 50, false);
+        
+        auto page = pager.next_page();
+        REQUIRE(page->get<int>(0, 0).value() == 95);
+        auto last = pager.next_page();
+        REQUIRE(last->row_count() == 45);
+        REQUIRE(last->get<int>(44, 0).value() == 1);
+        REQUIRE_FALSE(pager.next_page().has_value());
+    }
+}
+
+TEST_CASE("explain - Plan Capture", "[query][explain]") {
+    database_connection conn(TEST_CONNECTION_STRING);
+    
+    PQclear(conn.execute("CREATE TEMP TABLE test_explain (id INT PRIMARY KEY, category INT, label TEXT)"));
+    PQclear(conn.execute(
+        "INSERT INTO test_explain SELECT g, g % 10, 'item ' || g FROM generate_series(1, 5000) AS g"));
+    PQclear(conn.execute("ANALYZE test_explain"));
+    
+    SECTION("Plan tree with costs, timing and buffers") {
+        auto plan = explain(conn, "SELECT label FROM test_explain WHERE id = $1", {}, 42);
+        
+        REQUIRE(plan.uses_index("test_explain_pkey"));
+        REQUIRE_FALSE(plan.has_seq_scan("test_explain"));
+        REQUIRE(plan.total_cost() > 0.0);
+        REQUIRE(plan.execution_time().has_value());
+        REQUIRE(plan.root().actual_rows.value() == 1.0);
+        REQUIRE(plan.root().property("Index Cond").has_value());
+        REQUIRE_NOTHROW(plan.require({.uses_indexes = {"test_explain_pkey"}, .no_seq_scan_on = {"*"}}));
+    }
+    
+    SECTION("Regression checks report violations") {
+        auto plan = typed_query_builder(conn)
+            .select("category, COUNT(*)")
+            .from("test_explain")
+            .group_by("category")
+            .explain({.analyze = false, .buffers = false});
+        
+        REQUIRE(plan.has_seq_scan("test_explain"));
+        REQUIRE_FALSE(plan.execution_time().has_value());
+        
+        auto problems = plan.violations({.uses_indexes = {"test_explain_pkey"}, .max_total_cost = 1.0});
+        REQUIRE(problems.size() == 2);
+        REQUIRE_THROWS_AS(plan.require({.no_seq_scan_on = {"test_explain"}}), database_error);
+    }
+    
+    SECTION("ANALYZE of a data-modifying statement is rolled back") {
+        auto plan = explain(conn, "DELETE FROM test_explain WHERE category = 3");
+        REQUIRE(plan.root().node_type == "Delete");
+        
+        query_result count(conn.execute("SELECT COUNT(*) FROM test_explain"));
+        REQUIRE(count.get<int>(0, 0).value() == 5000);
+    }
+    
+    SECTION("ANALYZE inside an open transaction is undone with a savepoint") {
+        PQclear(conn.execute("BEGIN"));
+        PQclear(conn.execute("DELETE FROM test_explain WHERE category = 1"));
+        
+        auto plan = explain(conn, "DELETE FROM test_explain WHERE category = 3");
+        REQUIRE(plan.root().node_type == "Delete");
+        REQUIRE(conn.transaction_status() == PQTRANS_INTRANS);
+        
+        // Only the caller's own delete is left in the transaction
+        query_result count(conn.execute("SELECT COUNT(*) FROM test_explain"));
+        REQUIRE(count.get<int>(0, 0).value() == 4500);
+        PQclear(conn.execute("ROLLBACK"));
+    }
+    
+    SECTION("Escaped characters outside the BMP are decoded") {
+        auto plan = query_plan::parse(
+            R"([{"Plan": {"Node Type": "Seq Scan", "Relation Name": "t\ud83d\ude00", "Alias": "\u00e9"}}])");
+        REQUIRE(plan.root().relation_name == "t\xF0\x9F\x98\x80");
+        REQUIRE(plan.root().alias == "\xC3\xA9");
+        REQUIRE_THROWS_AS(query_plan::parse(R"([{"Plan": {"Node Type": "\ud83d"}}])"), database_error);
+    }
+}
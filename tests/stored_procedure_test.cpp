@@ -517,6 +517,41 @@ TEST_CASE("Async Stored Procedures - Error Handling", "[stored_procedure][async]
     }
 }
 
+TEST_CASE("Stored Procedures - Call Plans", "[stored_procedure][prepared]") {
+    StoredProcedureFixture fixture;
+    database_connection conn(TEST_CONN_STRING);
+    
+    SECTION("The call is prepared once and reused") {
+        for (int i = 0; i < 3; ++i) {
+            database_stored_procedure proc(conn, "test_add_numbers");
+            proc.add_param("a", i).add_param("b", 1);
+            REQUIRE(proc.execute_scalar<int>() == i + 1);
+        }
+        
+        query_result prepared(conn.execute(
+            "SELECT COUNT(*) FROM pg_prepared_statements WHERE statement LIKE '%test_add_numbers%'"));
+        REQUIRE(prepared.get<int>(0, 0).value() == 1);
+    }
+    
+    SECTION("Each arity gets its own plan") {
+        database_stored_procedure proc(conn, "test_get_constant");
+        REQUIRE(proc.execute_scalar<int>() == 42);
+        
+        proc.add_param("a", 1).add_param("b", 2);
+        REQUIRE_THROWS_AS(proc.execute(), database_error);
+        
+        database_stored_procedure add(conn, "test_add_numbers");
+        add.add_param("a", 1).add_param("b", 2);
+        REQUIRE(add.execute_scalar<int>() == 3);
+    }
+    
+    SECTION("Output parameters are skipped in the placeholders") {
+        database_stored_procedure proc(conn, "test_add_numbers");
+        proc.add_out_param("sum").add_param("a", 4).add_param("b", 5);
+        REQUIRE(proc.execute_scalar<int>() == 9);
+    }
+}
+
 TEST_CASE("Async Stored Procedures - Sync vs Async Comparison", "[stored_procedure][async][sync]") {
     StoredProcedureFixture fixture;
     net::io_context ioc;
@@ -604,6 +639,61 @@ TEST_CASE("Async Stored Procedures - Performance", "[stored_procedure][async][pe
     }
 }
 
+TEST_CASE("Async Stored Procedures - Gather", "[stored_procedure][async][pool]") {
+    StoredProcedureFixture fixture;
+    net::io_context ioc;
+    
+    database_pool::pool_config config{
+        .connection_string = TEST_CONN_STRING,
+        .min_connections = 3,
+        .max_connections = 3,
+        .io_context = &ioc
+    };
+    database_pool pool(config);
+    
+    SECTION("Calls run across pool connections and keep their order") {
+        std::vector<procedure_call> calls;
+        for (int i = 0; i < 5; ++i) {
+            calls.push_back(procedure_call("test_add_numbers").add_param("a", i).add_param("b", 10));
+        }
+        
+        gather_result gathered;
+        auto test_func = [&]() -> net::awaitable<void> {
+            gathered = co_await async_gather(pool, std::move(calls));
+        };
+        
+        net::co_spawn(ioc, test_func(), net::detached);
+        ioc.run();
+        
+        REQUIRE(gathered.ok());
+        REQUIRE(gathered.size() == 5);
+        for (int i = 0; i < 5; ++i) {
+            REQUIRE(gathered.get(i).get<int>(0, 0).value() == i + 10);
+        }
+        REQUIRE(pool.get_stats().active_connections == 0);
+    }
+    
+    SECTION("A failed call does not stop the others") {
+        std::vector<procedure_call> calls;
+        calls.push_back(procedure_call("test_get_constant"));
+        calls.push_back(procedure_call("nonexistent_function"));
+        calls.push_back(procedure_call("test_add_numbers").add_param("a", 1).add_param("b", 2));
+        
+        gather_result gathered;
+        auto test_func = [&]() -> net::awaitable<void> {
+            gathered = co_await async_gather(pool, std::move(calls));
+        };
+        
+        net::co_spawn(ioc, test_func(), net::detached);
+        ioc.run();
+        
+        REQUIRE_FALSE(gathered.ok());
+        REQUIRE(gathered.get(0).get<int>(0, 0).value() == 42);
+        REQUIRE_THROWS_AS(gathered.get(1), database_error);
+        REQUIRE(gathered.get(2).get<int>(0, 0).value() == 3);
+    }
+}
+
 TEST_CASE("Async Stored Procedures - Cleanup", "[stored_procedure][async][cleanup]") {
     database_connection conn(TEST_CONN_STRING);
     
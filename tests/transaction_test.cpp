@@ -4,6 +4,7 @@
 #include <thread>
 #include <vector>
 #include <atomic>
+#include <optional>
 
 using namespace fenrir;
 using namespace std::chrono_literals;
@@ -423,3 +424,277 @@ TEST_CASE("database_transaction - Concurrent Access", "[transaction][concurrent]
     auto cleanup_result = setup_conn.execute("DROP TABLE test_concurrent");
     PQclear(cleanup_result);
 }
+
+TEST_CASE("database_transaction - Lazy Begin", "[transaction][pipeline]") {
+    database_connection conn(TEST_CONNECTION_STRING);
+    
+    PQclear(conn.execute("CREATE TEMP TABLE test_lazy (id SERIAL, val INT)"));
+    
+    auto count_rows = [&conn]() {
+        query_result qr(conn.execute("SELECT COUNT(*) FROM test_lazy"));
+        return qr.get<int>(0, 0).value();
+    };
+    
+    SECTION("BEGIN goes out with the first statement") {
+        database_transaction txn(conn, transaction_options{.lazy_begin = true});
+        REQUIRE(conn.transaction_status() == PQTRANS_IDLE);
+        
+        auto result = txn.execute_params("INSERT INTO test_lazy (val) VALUES ($1) RETURNING val", 7);
+        REQUIRE(result.get<int>(0, 0).value() == 7);
+        REQUIRE(conn.transaction_status() == PQTRANS_INTRANS);
+        
+        txn.commit();
+        REQUIRE(count_rows() == 1);
+    }
+    
+    SECTION("An unused transaction sends nothing") {
+        database_transaction txn(conn, transaction_options{.lazy_begin = true});
+        txn.commit();
+        REQUIRE(conn.transaction_status() == PQTRANS_IDLE);
+    }
+    
+    SECTION("Deferred writes travel with COMMIT") {
+        with_transaction(conn, [](database_transaction& txn) {
+            (void)txn.execute("INSERT INTO test_lazy (val) VALUES (1)");
+            txn.execute_params_deferred("INSERT INTO test_lazy (val) VALUES ($1)", 2);
+            txn.execute_deferred("INSERT INTO test_lazy (val) VALUES (3)");
+            REQUIRE(txn.deferred_count() == 2);
+        }, transaction_options{.lazy_begin = true});
+        
+        REQUIRE(count_rows() == 3);
+    }
+    
+    SECTION("Deferred writes are flushed before the next read") {
+        database_transaction txn(conn, transaction_options{.lazy_begin = true});
+        txn.execute_deferred("INSERT INTO test_lazy (val) VALUES (1)");
+        
+        auto result = txn.execute("SELECT COUNT(*) FROM test_lazy");
+        REQUIRE(result.get<int>(0, 0).value() == 1);
+        REQUIRE(txn.deferred_count() == 0);
+        txn.rollback();
+        
+        REQUIRE(count_rows() == 0);
+    }
+    
+    SECTION("A failed deferred write fails the commit") {
+        REQUIRE_THROWS_AS(with_transaction(conn, [](database_transaction& txn) {
+            txn.execute_deferred("INSERT INTO test_lazy (val) VALUES (1)");
+            txn.execute_deferred("INSERT INTO test_lazy (val) VALUES ('not a number')");
+        }, transaction_options{.lazy_begin = true}), database_error);
+        
+        REQUIRE(conn.transaction_status() == PQTRANS_IDLE);
+        REQUIRE(count_rows() == 0);
+    }
+    
+    SECTION("Reading a deferred result flushes the queue") {
+        database_transaction txn(conn);
+        auto first = txn.execute_params_deferred("INSERT INTO test_lazy (val) VALUES ($1) RETURNING val", 10);
+        auto second = txn.execute_deferred("INSERT INTO test_lazy (val) VALUES (20) RETURNING val");
+        REQUIRE_FALSE(first.ready());
+        
+        REQUIRE(second.get().get<int>(0, 0).value() == 20);
+        REQUIRE(first.ready());
+        REQUIRE(first.get().get<int>(0, 0).value() == 10);
+        REQUIRE(txn.deferred_count() == 0);
+        txn.commit();
+        
+        REQUIRE(count_rows() == 2);
+    }
+    
+    SECTION("Deferred results outlive the transaction") {
+        std::optional<deferred_result> row;
+        with_transaction(conn, [&row](database_transaction& txn) {
+            row = txn.execute_deferred("INSERT INTO test_lazy (val) VALUES (5) RETURNING val");
+        });
+        
+        REQUIRE(row->ready());
+        REQUIRE(row->get().get<int>(0, 0).value() == 5);
+    }
+    
+    SECTION("Deferred writes fail with the error that stopped the flush") {
+        database_transaction txn(conn);
+        auto bad = txn.execute_deferred("INSERT INTO test_lazy (val) VALUES ('not a number')");
+        auto skipped = txn.execute_deferred("INSERT INTO test_lazy (val) VALUES (1)");
+        
+        REQUIRE_THROWS_AS(txn.commit(), database_error);
+        REQUIRE(bad.ready());
+        REQUIRE(skipped.ready());
+        REQUIRE_THROWS_AS(skipped.get(), database_error);
+        txn.rollback();
+        REQUIRE(count_rows() == 0);
+    }
+    
+    SECTION("Rolling back fails unsent writes") {
+        database_transaction txn(conn);
+        auto row = txn.execute_deferred("INSERT INTO test_lazy (val) VALUES (1)");
+        txn.rollback();
+        
+        REQUIRE(row.ready());
+        REQUIRE_THROWS_AS(row.get(), database_error);
+    }
+}
+
+TEST_CASE("database_transaction - Serialization Retries", "[transaction][retry]") {
+    database_connection conn(TEST_CONNECTION_STRING);
+    
+    PQclear(conn.execute("CREATE TEMP TABLE test_retry (id SERIAL, val INT)"));
+    
+    constexpr const char* raise_serialization_failure =
+        "DO $$ BEGIN RAISE EXCEPTION 'conflict' USING ERRCODE = 'serialization_failure'; END $$";
+    
+    SECTION("Serialization failures rerun the whole transaction") {
+        int attempts = 0;
+        size_t retries = 0;
+        retry_policy policy{.initial_backoff = 5ms};
+        policy.on_retry = [&](const database_error&, retry_reason reason, size_t, std::chrono::milliseconds) {
+            REQUIRE(reason == retry_reason::serialization_failure);
+            ++retries;
+        };
+        
+        auto value = with_transaction(conn, [&](database_transaction& txn) {
+            (void)txn.execute("INSERT INTO test_retry (val) VALUES (1)");
+            if (++attempts < 3) PQclear(txn.connection().execute(raise_serialization_failure));
+            return attempts;
+        }, isolation_level::serializable, policy);
+        
+        REQUIRE(value == 3);
+        REQUIRE(retries == 2);
+        
+        // Only the successful attempt was committed
+        query_result qr(conn.execute("SELECT COUNT(*) FROM test_retry"));
+        REQUIRE(qr.get<int>(0, 0).value() == 1);
+    }
+    
+    SECTION("Other errors are not retried") {
+        int attempts = 0;
+        REQUIRE_THROWS_AS(with_transaction(conn, [&](database_transaction& txn) {
+            ++attempts;
+            (void)txn.execute("SELECT * FROM no_such_table");
+        }, isolation_level::serializable, retry_policy{}), database_error);
+        REQUIRE(attempts == 1);
+    }
+    
+    SECTION("Retries stop at max_attempts") {
+        int attempts = 0;
+        REQUIRE_THROWS_AS(with_transaction(conn, [&](database_transaction& txn) {
+            ++attempts;
+            PQclear(txn.connection().execute(raise_serialization_failure));
+        }, isolation_level::serializable, retry_policy{.max_attempts = 2, .initial_backoff = 1ms}), database_error);
+        REQUIRE(attempts == 2);
+    }
+}
+
+TEST_CASE("async_transaction - Coroutines", "[transaction][async]") {
+    boost::asio::io_context ioc;
+    database_connection conn(TEST_CONNECTION_STRING);
+    conn.set_io_context(ioc);
+    
+    PQclear(conn.execute("CREATE TEMP TABLE test_async_txn (id SERIAL, val INT)"));
+    
+    auto count_rows = [&conn]() {
+        query_result qr(conn.execute("SELECT COUNT(*) FROM test_async_txn"));
+        return qr.get<int>(0, 0).value();
+    };
+    
+    SECTION("Commits when the lambda completes") {
+        int inserted = 0;
+        auto run = [&]() -> boost::asio::awaitable<void> {
+            inserted = co_await async_with_transaction(conn, [](async_transaction& txn) -> boost::asio::awaitable<int> {
+                (void)co_await txn.async_execute_params("INSERT INTO test_async_txn (val) VALUES ($1)", 100);
+                (void)co_await txn.async_execute_params("INSERT INTO test_async_txn (val) VALUES ($1)", 200);
+                co_return 2;
+            }, isolation_level::serializable);
+        };
+        boost::asio::co_spawn(ioc, run(), boost::asio::detached);
+        ioc.run();
+        
+        REQUIRE(inserted == 2);
+        REQUIRE(count_rows() == 2);
+        REQUIRE(conn.transaction_status() == PQTRANS_IDLE);
+    }
+    
+    SECTION("Rolls back when the lambda throws") {
+        bool caught = false;
+        auto run = [&]() -> boost::asio::awaitable<void> {
+            try {
+                co_await async_with_transaction(conn, [](async_transaction& txn) -> boost::asio::awaitable<void> {
+                    (void)co_await txn.async_execute("INSERT INTO test_async_txn (val) VALUES (100)");
+                    throw std::runtime_error("abort");
+                });
+            } catch (const std::runtime_error&) {
+                caught = true;
+            }
+        };
+        boost::asio::co_spawn(ioc, run(), boost::asio::detached);
+        ioc.run();
+        
+        REQUIRE(caught);
+        REQUIRE(count_rows() == 0);
+        REQUIRE(conn.transaction_status() == PQTRANS_IDLE);
+    }
+    
+    SECTION("Savepoints roll back only their own work") {
+        auto run = [&]() -> boost::asio::awaitable<void> {
+            auto txn = co_await async_transaction::begin(conn);
+            (void)co_await txn.async_execute("INSERT INTO test_async_txn (val) VALUES (1)");
+            try {
+                co_await txn.async_with_savepoint("sp1", [](async_transaction& inner) -> boost::asio::awaitable<void> {
+                    (void)co_await inner.async_execute("INSERT INTO test_async_txn (val) VALUES (2)");
+                    (void)co_await inner.async_execute("SELECT * FROM no_such_table");
+                });
+            } catch (const database_error&) {
+            }
+            (void)co_await txn.async_execute("INSERT INTO test_async_txn (val) VALUES (3)");
+            co_await txn.async_commit();
+        };
+        boost::asio::co_spawn(ioc, run(), boost::asio::detached);
+        ioc.run();
+        
+        REQUIRE(count_rows() == 2);
+    }
+    
+    SECTION("A transaction abandoned mid-flight is rolled back") {
+        {
+            boost::asio::io_context local;
+            conn.set_io_context(local);
+            auto run = [&]() -> boost::asio::awaitable<void> {
+                auto txn = co_await async_transaction::begin(conn);
+                (void)co_await txn.async_execute("INSERT INTO test_async_txn (val) VALUES (1)");
+                boost::asio::steady_timer timer(local, 1h);
+                co_await timer.async_wait(boost::asio::use_awaitable);
+            };
+            boost::asio::co_spawn(local, run(), boost::asio::detached);
+            local.run_for(200ms);
+            REQUIRE(conn.transaction_status() == PQTRANS_INTRANS);
+        }  // Destroying the io_context destroys the suspended coroutine
+        
+        REQUIRE(conn.transaction_status() == PQTRANS_IDLE);
+        REQUIRE(count_rows() == 0);
+    }
+}
+
+TEST_CASE("async_transaction - Pool", "[transaction][async][pool]") {
+    boost::asio::io_context ioc;
+    
+    database_pool pool({
+        .connection_string = TEST_CONNECTION_STRING,
+        .min_connections = 1,
+        .max_connections = 1,
+        .io_context = &ioc
+    });
+    
+    SECTION("The connection is acquired and returned around the transaction") {
+        std::optional<int> value;
+        auto run = [&]() -> boost::asio::awaitable<void> {
+            value = co_await async_with_transaction(pool, [](async_transaction& txn) -> boost::asio::awaitable<int> {
+                auto result = co_await txn.async_execute("SELECT 42");
+                co_return result.get<int>(0, 0).value();
+            });
+        };
+        boost::asio::co_spawn(ioc, run(), boost::asio::detached);
+        ioc.run();
+        
+        REQUIRE(value == 42);
+        REQUIRE(pool.get_stats().active_connections == 0);
+    }
+}